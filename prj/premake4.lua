@@ -7,9 +7,26 @@ example: http://opende.svn.sourceforge.net/viewvc/opende/trunk/build/premake4.lu
 http://bitbucket.org/anders/lightweight/src/tip/premake4.lua
 
 ]]
+
+-- C++17 is required, C++20 enables the OscReceiver::next() coroutine awaitable
+newoption {
+	trigger     = "std",
+	value       = "STD",
+	description = "C++ language standard: c++17 (default), c++20, etc"
+}
+
+-- a -std in the user's CXXFLAGS is kept as is
+local std = _OPTIONS["std"]
+if not std and not string.find(os.getenv("CXXFLAGS") or "", "-std=", 1, true) then
+	std = "c++17"
+end
+
 solution "lopack"
 	configurations { "Debug", "Release" }
 	objdir "obj"
+	if std then
+		buildoptions { "-std=" .. std }
+	end
  
 -- lopack library
 project "lopack"
@@ -19,8 +36,8 @@ project "lopack"
 	files { "../src/lopack/**.h", "../src/lopack/**.cpp" }
 	
 	configuration "linux"
-		buildoptions { "`pkg-config --cflags liblo`" }
-		linkoptions { "`pkg-config --libs liblo`" }
+		buildoptions { "`pkg-config --cflags liblo`", "-pthread" }
+		linkoptions { "`pkg-config --libs liblo`", "-pthread" }
 	
 	configuration "macosx"
 		-- Homebrew & MacPorts
@@ -46,8 +63,64 @@ project "lptest"
 	links { "lopack" }
 
 	configuration "linux"
-		buildoptions { "`pkg-config --cflags liblo`" }
-		linkoptions { "`pkg-config --libs liblo`" }
+		buildoptions { "`pkg-config --cflags liblo`", "-pthread" }
+		linkoptions { "`pkg-config --libs liblo`", "-pthread" }
+
+	configuration 'macosx'
+		-- Homebrew & MacPorts
+		includedirs { "/usr/local/include", "/opt/local/include"}
+		libdirs { "/usr/local/lib", "/opt/local/lib" }
+		links { "lo", "pthread" }
+
+	configuration "Debug"
+		defines { "DEBUG" }
+		flags { "Symbols" }
+
+	configuration "Release"
+		defines { "NDEBUG" }
+		flags { "Optimize" }
+
+-- benchmark executable
+project "lpbench"
+	kind "ConsoleApp"
+	language "C++"
+	targetdir "../src/lpbench"
+	files { "../src/lpbench/**.h", "../src/lpbench/**.cpp" }
+
+	includedirs { "../src" }
+	links { "lopack" }
+
+	configuration "linux"
+		buildoptions { "`pkg-config --cflags liblo`", "-pthread" }
+		linkoptions { "`pkg-config --libs liblo`", "-pthread" }
+
+	configuration 'macosx'
+		-- Homebrew & MacPorts
+		includedirs { "/usr/local/include", "/opt/local/include"}
+		libdirs { "/usr/local/lib", "/opt/local/lib" }
+		links { "lo", "pthread" }
+
+	configuration "Debug"
+		defines { "DEBUG" }
+		flags { "Symbols" }
+
+	configuration "Release"
+		defines { "NDEBUG" }
+		flags { "Optimize" }
+
+-- load generator executable
+project "lpblast"
+	kind "ConsoleApp"
+	language "C++"
+	targetdir "../src/lpblast"
+	files { "../src/lpblast/**.h", "../src/lpblast/**.cpp" }
+
+	includedirs { "../src" }
+	links { "lopack" }
+
+	configuration "linux"
+		buildoptions { "`pkg-config --cflags liblo`", "-pthread" }
+		linkoptions { "`pkg-config --libs liblo`", "-pthread" }
 
 	configuration 'macosx'
 		-- Homebrew & MacPorts
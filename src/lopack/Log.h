@@ -20,18 +20,53 @@
 ==============================================================================*/
 #pragma once
 
-#include <iostream>
-#include <sstream>
-
-// convenience defines
-#define LOG        Log(Log::LOG_LEVEL_NORMAL)
-#define LOG_DEBUG  Log(Log::LOG_LEVEL_DEBUG)
-#define LOG_WARN   Log(Log::LOG_LEVEL_WARN)
-#define LOG_ERROR  Log(Log::LOG_LEVEL_ERROR)
+#include "OscLog.h"
+#include <ostream>
+#include <streambuf>
+
+// min log level to compile in: 0 debug, 1 normal, 2 warn, 3 error, 4 none
+#ifndef LOPACK_LOG_MIN_LEVEL
+	#ifdef DEBUG
+		#define LOPACK_LOG_MIN_LEVEL 0
+	#else
+		#define LOPACK_LOG_MIN_LEVEL 1
+	#endif
+#endif
+
+// convenience defines, disabled levels expand to a loop which never runs
+// so the line is type checked but no code is generated
+#define LOG_DISABLED(level) while(0) Log(level)
+
+#if LOPACK_LOG_MIN_LEVEL <= 0
+	#define LOG_DEBUG  Log(osc::LOG_LEVEL_DEBUG)
+#else
+	#define LOG_DEBUG  LOG_DISABLED(osc::LOG_LEVEL_DEBUG)
+#endif
+
+#if LOPACK_LOG_MIN_LEVEL <= 1
+	#define LOG        Log(osc::LOG_LEVEL_NORMAL)
+#else
+	#define LOG        LOG_DISABLED(osc::LOG_LEVEL_NORMAL)
+#endif
+
+#if LOPACK_LOG_MIN_LEVEL <= 2
+	#define LOG_WARN   Log(osc::LOG_LEVEL_WARN)
+#else
+	#define LOG_WARN   LOG_DISABLED(osc::LOG_LEVEL_WARN)
+#endif
+
+#if LOPACK_LOG_MIN_LEVEL <= 3
+	#define LOG_ERROR  Log(osc::LOG_LEVEL_ERROR)
+#else
+	#define LOG_ERROR  LOG_DISABLED(osc::LOG_LEVEL_ERROR)
+#endif
 
 /// \class Log
 /// \brief a simple stream-based logger
 ///
+/// formats into a fixed size line buffer, without allocating, & queues the
+/// line for the background log thread on exit, see OscLog.h
+///
 /// class idea from:
 /// http://www.gamedev.net/community/forums/topic.asp?topic_id=525405&whichpage=1&#3406418
 /// how to catch std::endl (which is actually a func pointer):
@@ -41,59 +76,41 @@ class Log {
 
 	public:
 
-		/// log level enum
-		enum Level {
-			LOG_LEVEL_NORMAL,
-			LOG_LEVEL_DEBUG,
-			LOG_LEVEL_WARN,
-			LOG_LEVEL_ERROR
-		};
-
 		/// select log level, default: normal
-		Log(Level level=LOG_LEVEL_NORMAL) : m_level(level) {}
+		Log(osc::LogLevel level=osc::LOG_LEVEL_NORMAL) :
+			m_level(level), m_buffer(m_line, sizeof(m_line)), m_stream(&m_buffer) {}
 
-		/// does the actual printing on exit
+		/// queues the line on exit
 		~Log() {
-			switch(m_level) {
-
-				case LOG_LEVEL_NORMAL:
-					// must flush or we wont get any output until *after* the mainLoop
-					std::cout << m_line.str();
-					break;
-
-				case LOG_LEVEL_DEBUG:
-					#ifdef DEBUG
-					std::cout << "Debug: " << m_line.str();
-					#endif
-					break;
-
-				case LOG_LEVEL_WARN:
-					std::cerr << "Warn: " << m_line.str();
-					break;
-
-				case LOG_LEVEL_ERROR:
-					std::cerr << "Error: " << m_line.str();
-					break;
-			}
+			osc::logLine(m_level, m_line, m_buffer.length());
 		}
 
 		/// catch << with a template class to read any type of data
 		template <class T> Log& operator<<(const T &value) {
-			m_line << value;
+			m_stream << value;
 			return *this;
 		}
 
 		/// catch << ostream function pointers such as std::endl and std::hex
 		Log& operator<<(std::ostream &(*func)(std::ostream&)) {
-			func(m_line);
+			func(m_stream);
 			return *this;
 		}
 
 	private:
 
+		/// stream buffer over a fixed char array, output past the end is dropped
+		class LineBuffer : public std::streambuf {
+			public:
+				LineBuffer(char *line, size_t size) {setp(line, line + size);}
+				size_t length() const {return pptr() - pbase();}
+		};
+
 		Log(Log const&);              // not defined, not copyable
 		Log& operator = (Log const&); // not defined, not assignable
 
-		Level m_level;                ///< log level
-		std::ostringstream m_line;    ///< temp buffer
+		osc::LogLevel m_level;          ///< log level
+		char m_line[osc::LOG_LINE_SIZE]; ///< line text
+		LineBuffer m_buffer;            ///< stream buffer writing to m_line
+		std::ostream m_stream;          ///< formatting stream
 };
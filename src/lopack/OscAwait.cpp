@@ -0,0 +1,159 @@
+/*==============================================================================
+
+	OscAwait.cpp
+
+	lopack: an oscpack-inspired C++ wrapper for liblo
+
+	Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================*/
+#include "OscAwait.h"
+
+#include <vector>
+
+namespace osc {
+
+MessageWaiters::MessageWaiters() : m_size(0), m_timed(0) {}
+
+MessageWaiters::~MessageWaiters() {
+	cancelAll();
+}
+
+void MessageWaiters::add(Waiter &waiter) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	waiter.message.reset();
+	List &list = m_lists[waiter.address];
+	waiter.m_prev = list.tail;
+	waiter.m_next = NULL;
+	if(list.tail) {
+		list.tail->m_next = &waiter;
+	}
+	else {
+		list.head = &waiter;
+	}
+	list.tail = &waiter;
+	waiter.m_hasTimer = waiter.timeout >= 0;
+	if(waiter.m_hasTimer) {
+		Clock::time_point deadline = Clock::now() +
+			std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(waiter.timeout));
+		waiter.m_timer = m_timers.insert(std::make_pair(deadline, &waiter));
+		m_timed++;
+	}
+	m_size++;
+}
+
+bool MessageWaiters::remove(Waiter &waiter) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::map<std::string, List, std::less<> >::iterator iter = m_lists.find(waiter.address);
+	if(iter == m_lists.end()) {
+		return false;
+	}
+	// make sure it's still waiting
+	Waiter *w = iter->second.head;
+	while(w && w != &waiter) {
+		w = w->m_next;
+	}
+	if(!w) {
+		return false;
+	}
+	unlink(waiter);
+	return true;
+}
+
+bool MessageWaiters::dispatch(const ReceivedMessage &message) {
+	if(m_size.load() == 0) {
+		return false;
+	}
+	Waiter *waiter;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::map<std::string, List, std::less<> >::iterator iter = m_lists.find(message.addressView());
+		if(iter == m_lists.end()) {
+			return false;
+		}
+		waiter = iter->second.head;
+		unlink(*waiter);
+	}
+	waiter->message.emplace(message.clone()); // the waiter may outlive dispatch on any thread
+	waiter->complete(waiter);
+	return true;
+}
+
+void MessageWaiters::expire() {
+	if(m_timed.load() == 0) {
+		return;
+	}
+	std::vector<Waiter*> expired;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		Clock::time_point now = Clock::now();
+		while(!m_timers.empty() && m_timers.begin()->first <= now) {
+			Waiter *waiter = m_timers.begin()->second;
+			unlink(*waiter);
+			expired.push_back(waiter);
+		}
+	}
+	for(unsigned int i = 0; i < expired.size(); ++i) {
+		expired[i]->complete(expired[i]);
+	}
+}
+
+void MessageWaiters::cancelAll() {
+	std::vector<Waiter*> cancelled;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		while(!m_lists.empty()) {
+			Waiter *waiter = m_lists.begin()->second.head;
+			unlink(*waiter);
+			cancelled.push_back(waiter);
+		}
+	}
+	for(unsigned int i = 0; i < cancelled.size(); ++i) {
+		cancelled[i]->complete(cancelled[i]);
+	}
+}
+
+// PRIVATE
+
+void MessageWaiters::unlink(Waiter &waiter) {
+	std::map<std::string, List, std::less<> >::iterator iter = m_lists.find(waiter.address);
+	List &list = iter->second;
+	if(waiter.m_prev) {
+		waiter.m_prev->m_next = waiter.m_next;
+	}
+	else {
+		list.head = waiter.m_next;
+	}
+	if(waiter.m_next) {
+		waiter.m_next->m_prev = waiter.m_prev;
+	}
+	else {
+		list.tail = waiter.m_prev;
+	}
+	if(!list.head) {
+		m_lists.erase(iter);
+	}
+	if(waiter.m_hasTimer) {
+		m_timers.erase(waiter.m_timer);
+		waiter.m_hasTimer = false;
+		m_timed--;
+	}
+	waiter.m_prev = NULL;
+	waiter.m_next = NULL;
+	m_size--;
+}
+
+} // namespace
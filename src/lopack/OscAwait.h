@@ -0,0 +1,179 @@
+/*==============================================================================
+
+	OscAwait.h
+
+	lopack: an oscpack-inspired C++ wrapper for liblo
+
+	Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================*/
+#pragma once
+
+#include "OscTypes.h"
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <optional>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+	#include <coroutine>
+	#include <exception>
+	#define LOPACK_HAVE_COROUTINES 1
+#endif
+
+namespace osc {
+
+/// \class MessageWaiters
+/// \brief messages being waited for by address, with timeouts
+///
+/// each incoming message completes the oldest waiter for its address, or
+/// none if nobody is waiting; waiters are linked into a list per address,
+/// so waiting allocates the address copy, a map node for the first waiter
+/// on an address, & a timer node for a wait with a timeout, dispatching a
+/// message to a waiter does not allocate; completion callbacks are called
+/// outside the lock from the thread which dispatched the message or
+/// expired the timeout
+class MessageWaiters {
+
+	public:
+
+		typedef std::chrono::steady_clock Clock;
+
+		/// a pending wait, must stay valid until completed or removed
+		struct Waiter {
+
+			/// called once when a message arrives, the timeout expires, or
+			/// the wait is cancelled; message is empty on timeout or cancel
+			void (*complete)(Waiter *waiter);
+			void *userData; ///< for the complete callback
+
+			std::optional<ReceivedMessage> message; ///< the message, if any
+
+			std::string address;  ///< address to wait for
+			double timeout;       ///< seconds, < 0 waits forever
+
+			Waiter() : complete(NULL), userData(NULL), timeout(-1),
+				m_prev(NULL), m_next(NULL), m_hasTimer(false) {}
+
+			private:
+
+				friend class MessageWaiters;
+				Waiter *m_prev; ///< previous waiter for the same address
+				Waiter *m_next; ///< next waiter for the same address
+				bool m_hasTimer; ///< is the waiter in the timer map?
+				std::multimap<Clock::time_point, Waiter*>::iterator m_timer;
+		};
+
+		MessageWaiters();
+
+		/// cancels all waiters
+		virtual ~MessageWaiters();
+
+		/// start waiting, safe to call from any thread
+		void add(Waiter &waiter);
+
+		/// stop waiting without completing, returns false if the waiter was
+		/// not waiting, ie. already completed
+		bool remove(Waiter &waiter);
+
+		/// complete the oldest waiter for the message's address,
+		/// returns true if a waiter took the message
+		bool dispatch(const ReceivedMessage &message);
+
+		/// complete all waiters whose timeout has passed
+		void expire();
+
+		/// complete all waiters without a message
+		void cancelAll();
+
+		/// get the number of waiters
+		inline unsigned int size() const {return m_size.load();}
+
+	private:
+
+		MessageWaiters(MessageWaiters const&);              // not copyable
+		MessageWaiters& operator = (MessageWaiters const&); // not assignable
+
+		/// waiters for an address, oldest first
+		struct List {
+			Waiter *head;
+			Waiter *tail;
+			List() : head(NULL), tail(NULL) {}
+		};
+
+		/// unlink a waiter, call with m_mutex locked
+		void unlink(Waiter &waiter);
+
+		std::mutex m_mutex; ///< guards the lists & timers
+		std::map<std::string, List, std::less<> > m_lists; ///< waiters by address
+		std::multimap<Clock::time_point, Waiter*> m_timers; ///< waiters by deadline
+		std::atomic<unsigned int> m_size;   ///< number of waiters
+		std::atomic<unsigned int> m_timed;  ///< number of waiters with timeouts
+};
+
+#ifdef LOPACK_HAVE_COROUTINES
+
+/// \class MessageAwaitable
+/// \brief co_await an incoming message, see OscReceiver::next()
+///
+/// resumes the awaiting coroutine on the receiver thread which dispatched
+/// the message or expired the timeout, the result is empty on timeout
+class MessageAwaitable {
+
+	public:
+
+		MessageAwaitable(MessageWaiters &waiters, std::string_view address, double timeout) :
+			m_waiters(waiters) {
+			m_waiter.complete = &resumeCB;
+			m_waiter.address = address;
+			m_waiter.timeout = timeout;
+		}
+
+		bool await_ready() const {return false;}
+
+		void await_suspend(std::coroutine_handle<> handle) {
+			m_waiter.userData = handle.address();
+			m_waiters.add(m_waiter); // may resume on another thread right away
+		}
+
+		std::optional<ReceivedMessage> await_resume() {return std::move(m_waiter.message);}
+
+	private:
+
+		static void resumeCB(MessageWaiters::Waiter *waiter) {
+			std::coroutine_handle<>::from_address(waiter->userData).resume();
+		}
+
+		MessageWaiters &m_waiters;
+		MessageWaiters::Waiter m_waiter;
+};
+
+/// a fire & forget coroutine, starts when called & frees itself when done,
+/// ie. osc::Task converse(osc::OscReceiver &receiver) {... co_await ...}
+struct Task {
+	struct promise_type {
+		Task get_return_object() {return Task();}
+		std::suspend_never initial_suspend() noexcept {return {};}
+		std::suspend_never final_suspend() noexcept {return {};}
+		void return_void() {}
+		void unhandled_exception() {std::terminate();}
+	};
+};
+
+#endif
+
+} // namespace
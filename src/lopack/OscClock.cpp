@@ -0,0 +1,298 @@
+/*==============================================================================
+
+	OscClock.cpp
+
+	lopack: an oscpack-inspired C++ wrapper for liblo
+
+	Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================*/
+#include "OscClock.h"
+
+#include "OscReceiver.h"
+#include "Log.h"
+#include <algorithm>
+#include <math.h>
+
+namespace osc {
+
+// max drift estimate, as in NTP
+static const double MAX_DRIFT = 0.0005;
+
+// min filtered samples for a drift estimate
+static const unsigned int MIN_DRIFT_SAMPLES = 4;
+
+// add seconds to a time tag, keeping the full 1/2^32 second resolution
+static TimeTag addSeconds(const TimeTag &tag, double seconds) {
+	uint64_t time = ((uint64_t) tag.sec << 32) | tag.frac;
+	time += (uint64_t) llround(seconds * 4294967296.0); // wraps for negative seconds
+	return TimeTag((uint32_t) (time >> 32), (uint32_t) time);
+}
+
+// CLOCK SYNC
+
+ClockSync::ClockSync(const std::string &host, unsigned int port, OscReceiver &receiver,
+                     const std::string &pingAddress, const std::string &replyAddress) :
+	m_sender(host, port), m_pingAddress(pingAddress), m_hasBase(false),
+	m_filterSize(8), m_driftSize(64), m_offset(0), m_time(0), m_drift(0),
+	m_pinging(false), m_interval(1), m_timeout(0.5),
+	m_rpc(m_sender, receiver, replyAddress) {}
+
+ClockSync::~ClockSync() {
+	stop();
+}
+
+// PINGING
+
+void ClockSync::start(double interval, double timeout) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_interval = std::max(interval, 0.001);
+	m_timeout = std::max(timeout, 0.0);
+	if(m_pinging) {
+		m_condition.notify_one(); // use the new interval
+		return;
+	}
+	m_pinging = true;
+	m_thread = std::thread(&ClockSync::run, this);
+}
+
+void ClockSync::stop() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if(!m_pinging) {
+			return;
+		}
+		m_pinging = false;
+		m_condition.notify_one();
+	}
+	m_thread.join();
+}
+
+bool ClockSync::ping(double timeout) {
+	std::lock_guard<std::mutex> lock(m_sendMutex);
+	int32_t id = m_rpc.beginRequest(m_pingAddress);
+	m_sender.addTimeTag(TimeTag()); // t1, as late as possible
+	m_sender.endMessage();
+	if(!m_rpc.send(id, timeout, [this](const ReceivedMessage *message) {reply(message);})) {
+		LOG_WARN << "ClockSync: could not send ping: " << m_sender.getErrorString() << std::endl;
+		return false;
+	}
+	std::lock_guard<std::mutex> statsLock(m_mutex);
+	m_stats.pings++;
+	return true;
+}
+
+void ClockSync::setWindow(unsigned int filterSize, unsigned int driftSize) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_filterSize = std::max(filterSize, 1U);
+	m_driftSize = std::max(driftSize, 1U);
+	while(m_recent.size() > m_filterSize) {
+		m_recent.pop_front();
+	}
+	while(m_filtered.size() > m_driftSize) {
+		m_filtered.pop_front();
+	}
+}
+
+void ClockSync::reset() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_hasBase = false;
+	m_recent.clear();
+	m_filtered.clear();
+	m_offset = 0;
+	m_time = 0;
+	m_drift = 0;
+	m_stats = ClockStats();
+}
+
+// REMOTE CLOCK
+
+bool ClockSync::isSynchronized() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return !m_filtered.empty();
+}
+
+TimeTag ClockSync::now() {
+	return toRemote(TimeTag());
+}
+
+TimeTag ClockSync::at(unsigned int ms) {
+	return toRemote(TimeTag(ms));
+}
+
+TimeTag ClockSync::toRemote(const TimeTag &local) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if(!m_hasBase) {
+		return local;
+	}
+	return addSeconds(local, offsetAt(local - m_base));
+}
+
+TimeTag ClockSync::toLocal(const TimeTag &remote) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if(!m_hasBase) {
+		return remote;
+	}
+	// the offset depends on the local time, refine the first guess once
+	double time = remote - m_base;
+	time -= offsetAt(time);
+	return addSeconds(remote, -offsetAt(time));
+}
+
+ClockStats ClockSync::getStats() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	ClockStats stats = m_stats;
+	if(m_hasBase) {
+		stats.offset = offsetAt(TimeTag() - m_base);
+	}
+	return stats;
+}
+
+// PRIVATE
+
+void ClockSync::reply(const ReceivedMessage *message) {
+	if(!message) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stats.timeouts++;
+		return;
+	}
+	if(message->numArgs() < 4 || !message->isTimeTag(1) ||
+	   !message->isTimeTag(2) || !message->isTimeTag(3)) {
+		LOG_WARN << "ClockSync: ignoring malformed reply from responder" << std::endl;
+		return;
+	}
+	TimeTag sent = message->asTimeTag(1);            // t1, local
+	TimeTag received = message->asTimeTag(2);        // t2, remote
+	TimeTag replied = message->asTimeTag(3);         // t3, remote
+	TimeTag arrived = message->getArrivalTime();     // t4, local
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stats.replies++;
+	if(!m_hasBase) {
+		m_base = sent;
+		m_hasBase = true;
+	}
+	Sample sample;
+	sample.time = arrived - m_base;
+	sample.offset = ((received - sent) + (replied - arrived)) / 2;
+	sample.delay = std::max((arrived - sent) - (replied - received), 0.0);
+	addSample(sample);
+}
+
+void ClockSync::addSample(const Sample &sample) {
+	m_recent.push_back(sample);
+	if(m_recent.size() > m_filterSize) {
+		m_recent.pop_front();
+	}
+
+	// clock filter: the lowest delay sample has the least queueing error,
+	// each best sample is only used once
+	const Sample *best = &m_recent.front();
+	for(unsigned int i = 1; i < m_recent.size(); ++i) {
+		if(m_recent[i].delay < best->delay) {
+			best = &m_recent[i];
+		}
+	}
+	m_stats.delay = best->delay;
+	if(!m_filtered.empty() && m_filtered.back().time >= best->time) {
+		return;
+	}
+	m_filtered.push_back(*best);
+	if(m_filtered.size() > m_driftSize) {
+		m_filtered.pop_front();
+	}
+
+	// least squares fit of the filtered offsets over time, the line passes
+	// through the mean time & offset with the drift as its slope
+	unsigned int n = m_filtered.size();
+	double meanTime = 0, meanOffset = 0;
+	for(unsigned int i = 0; i < n; ++i) {
+		meanTime += m_filtered[i].time;
+		meanOffset += m_filtered[i].offset;
+	}
+	meanTime /= n;
+	meanOffset /= n;
+	double drift = 0;
+	if(n >= MIN_DRIFT_SAMPLES) {
+		double sxx = 0, sxy = 0;
+		for(unsigned int i = 0; i < n; ++i) {
+			double dt = m_filtered[i].time - meanTime;
+			sxx += dt * dt;
+			sxy += dt * (m_filtered[i].offset - meanOffset);
+		}
+		if(sxx > 0) {
+			drift = std::min(std::max(sxy / sxx, -MAX_DRIFT), MAX_DRIFT);
+		}
+	}
+	m_time = meanTime;
+	m_offset = meanOffset;
+	m_drift = drift;
+
+	double error = 0;
+	for(unsigned int i = 0; i < n; ++i) {
+		double residual = m_filtered[i].offset - offsetAt(m_filtered[i].time);
+		error += residual * residual;
+	}
+	m_stats.jitter = sqrt(error / n);
+	m_stats.drift = m_drift;
+	m_stats.samples = n;
+}
+
+double ClockSync::offsetAt(double time) {
+	return m_offset + m_drift * (time - m_time);
+}
+
+void ClockSync::run() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while(m_pinging) {
+		double timeout = m_timeout;
+		lock.unlock();
+		ping(timeout);
+		lock.lock();
+		m_condition.wait_for(lock, std::chrono::duration<double>(m_interval));
+	}
+}
+
+// CLOCK RESPONDER
+
+ClockResponder::ClockResponder(OscReceiver &receiver, const std::string &pingAddress,
+                               const std::string &replyAddress) :
+	OscObject(pingAddress), m_receiver(receiver), m_responder(replyAddress) {
+	m_receiver.addOscObject(this);
+}
+
+ClockResponder::~ClockResponder() {
+	m_receiver.removeOscObject(this);
+}
+
+// PROTECTED
+
+bool ClockResponder::processOscMessage(const ReceivedMessage &message, const MessageSource &source) {
+	if(message.addressView() != oscRootAddress || !RpcResponder::isRequest(message) ||
+	   message.numArgs() <= RpcResponder::FIRST_ARG || !message.isTimeTag(RpcResponder::FIRST_ARG)) {
+		return false;
+	}
+	TimeTag received = message.getArrivalTime(); // t2
+	OscSender &sender = m_responder.beginReply(message, source);
+	sender.addTimeTag(message.asTimeTag(RpcResponder::FIRST_ARG)); // echo t1
+	sender.addTimeTag(received);
+	sender.addTimeTag(TimeTag()); // t3, as late as possible
+	sender.endMessage();
+	sender.send();
+	return true;
+}
+
+} // namespace
@@ -0,0 +1,215 @@
+/*==============================================================================
+
+	OscClock.h
+
+	lopack: an oscpack-inspired C++ wrapper for liblo
+
+	Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================*/
+#pragma once
+
+#include "OscRpc.h"
+#include "OscSender.h"
+#include <deque>
+
+namespace osc {
+
+/// \section Clock Message Format
+///
+/// a ping is an rpc request, see OscRpc.h, with the requester's send time
+/// tag t1; the reply echoes t1 followed by the responder's receive time tag
+/// t2 & send time tag t3, the requester's receive time is t4:
+///
+///   offset = ((t2 - t1) + (t3 - t4)) / 2
+///   delay  = (t4 - t1) - (t3 - t2)
+
+/// default clock ping address
+#define LOPACK_CLOCK_PING "/lopack/clock/ping"
+
+/// default clock reply address
+#define LOPACK_CLOCK_REPLY "/lopack/clock/reply"
+
+/// clock estimate & counters
+struct ClockStats {
+	double offset;  ///< remote - local clock offset in seconds, now
+	double drift;   ///< remote clock rate relative to local, ie. 0.00001 = 10 ppm fast
+	double delay;   ///< round trip delay of the best recent sample in seconds
+	double jitter;  ///< rms offset error of the filtered samples in seconds
+	uint64_t pings;    ///< pings sent
+	uint64_t replies;  ///< replies received
+	uint64_t timeouts; ///< pings without a reply
+	unsigned int samples; ///< filtered samples in the estimate
+
+	ClockStats() : offset(0), drift(0), delay(0), jitter(0),
+		pings(0), replies(0), timeouts(0), samples(0) {}
+};
+
+/// \class ClockSync
+/// \brief estimates a remote node's clock for scheduling bundles
+///
+/// pings a ClockResponder on the remote node, estimates the offset of the
+/// remote clock from each round trip, NTP style, & the drift between the
+/// clocks from the offsets over time; the estimate then converts local time
+/// tags to the remote clock, so future bundles run when intended on the
+/// remote node instead of off by the difference in wall clocks:
+///
+///   osc::ClockSync sync("192.168.1.10", 9000, receiver);
+///   sync.start();
+///   ...
+///   sender << osc::BeginBundle(sync.at(25)) // 25 ms from now, remote time
+///
+/// each reply is filtered with the recent samples & only the sample with the
+/// lowest delay is used, as it has the least queueing error; the receiver
+/// must be running or polled to receive the replies
+///
+/// note: arrival times are kernel receive timestamps when available, see
+///       ReceivedMessage::getArrivalTime()
+class ClockSync {
+
+	public:
+
+		/// ping the ClockResponder at host & port, receive the replies with
+		/// receiver
+		ClockSync(const std::string &host, unsigned int port, OscReceiver &receiver,
+		          const std::string &pingAddress=LOPACK_CLOCK_PING,
+		          const std::string &replyAddress=LOPACK_CLOCK_REPLY);
+
+		/// stops pinging
+		virtual ~ClockSync();
+
+	/// \section Pinging
+
+		/// start pinging every interval seconds on a background thread,
+		/// timeout is the seconds to wait for each reply
+		void start(double interval=1, double timeout=0.5);
+
+		/// stop pinging
+		void stop();
+
+		/// send a single ping, returns false if the send failed
+		bool ping(double timeout=0.5);
+
+		/// set the number of recent samples to filter, default 8, & the max
+		/// filtered samples used to estimate drift, default 64
+		void setWindow(unsigned int filterSize, unsigned int driftSize=64);
+
+		/// clear the estimate
+		void reset();
+
+	/// \section Remote Clock
+
+		/// is there an estimate?
+		bool isSynchronized();
+
+		/// get the remote clock now
+		TimeTag now();
+
+		/// get the remote clock ms milliseconds from now, ie. for a bundle
+		TimeTag at(unsigned int ms);
+
+		/// convert a local time tag to the remote clock
+		TimeTag toRemote(const TimeTag &local);
+
+		/// convert a remote time tag to the local clock
+		TimeTag toLocal(const TimeTag &remote);
+
+		/// get the estimate & counters
+		ClockStats getStats();
+
+	private:
+
+		ClockSync(ClockSync const&);              // not copyable
+		ClockSync& operator = (ClockSync const&); // not assignable
+
+		/// a round trip sample, times are local seconds since m_base
+		struct Sample {
+			double time;   ///< local receive time
+			double offset; ///< remote - local
+			double delay;  ///< round trip delay
+		};
+
+		/// handle a reply or timeout
+		void reply(const ReceivedMessage *reply);
+
+		/// add a sample & update the estimate
+		void addSample(const Sample &sample);
+
+		/// get the offset at a local time, call with m_mutex locked
+		double offsetAt(double time);
+
+		/// ping thread loop
+		void run();
+
+		OscSender m_sender; ///< sends pings
+		std::string m_pingAddress; ///< ping message address
+
+		std::mutex m_sendMutex; ///< serializes pings
+
+		std::mutex m_mutex; ///< guards the samples, estimate, & stats
+		std::condition_variable m_condition; ///< signals stop
+		TimeTag m_base;             ///< local time of the first sample
+		bool m_hasBase;             ///< is m_base set?
+		std::deque<Sample> m_recent;   ///< recent samples to filter
+		std::deque<Sample> m_filtered; ///< best samples for the drift
+		unsigned int m_filterSize; ///< max recent samples
+		unsigned int m_driftSize;  ///< max filtered samples
+		double m_offset; ///< estimated offset at m_time
+		double m_time;   ///< local time of the estimate
+		double m_drift;  ///< estimated drift
+		ClockStats m_stats; ///< counters
+
+		std::thread m_thread; ///< ping thread
+		bool m_pinging;       ///< keep the ping thread running?
+		double m_interval;    ///< seconds between pings
+		double m_timeout;     ///< seconds to wait for a reply
+
+		RpcClient m_rpc; ///< routes replies, destroyed first
+};
+
+/// \class ClockResponder
+/// \brief replies to ClockSync pings with the local clock
+///
+/// add one to each node whose clock others schedule against:
+///
+///   osc::ClockResponder responder(receiver);
+///
+/// replies are sent from the receiver's dispatch thread
+class ClockResponder : protected OscObject {
+
+	public:
+
+		/// adds itself to the receiver as an OscObject
+		ClockResponder(OscReceiver &receiver,
+		               const std::string &pingAddress=LOPACK_CLOCK_PING,
+		               const std::string &replyAddress=LOPACK_CLOCK_REPLY);
+		virtual ~ClockResponder();
+
+	protected:
+
+		/// reply to pings
+		bool processOscMessage(const ReceivedMessage &message, const MessageSource &source);
+
+	private:
+
+		ClockResponder(ClockResponder const&);              // not copyable
+		ClockResponder& operator = (ClockResponder const&); // not assignable
+
+		OscReceiver &m_receiver;
+		RpcResponder m_responder; ///< replies to pings
+};
+
+} // namespace
@@ -0,0 +1,106 @@
+/*==============================================================================
+
+	OscHandlers.cpp
+
+	lopack: an oscpack-inspired C++ wrapper for liblo
+
+	Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================*/
+#include "OscHandlers.h"
+
+namespace osc {
+
+HandlerRegistry::~HandlerRegistry() {
+	clear();
+}
+
+void HandlerRegistry::remove(std::string_view address) {
+	std::unordered_map<std::string_view, Entry*>::iterator iter = m_entries.find(address);
+	if(iter != m_entries.end()) {
+		Entry *entry = iter->second;
+		m_entries.erase(iter); // erase before the key's storage is freed
+		if(entry->id) {
+			m_ids[entry->id] = NULL;
+		}
+		delete entry;
+	}
+}
+
+void HandlerRegistry::clear() {
+	std::unordered_map<std::string_view, Entry*>::iterator iter;
+	for(iter = m_entries.begin(); iter != m_entries.end(); ++iter) {
+		delete iter->second;
+	}
+	m_entries.clear();
+	m_ids.clear();
+}
+
+bool HandlerRegistry::dispatch(const ReceivedMessage &message) const {
+	if(m_entries.empty()) {
+		return false;
+	}
+	const Entry *entry = NULL;
+	AddressId id = message.addressId();
+	if(id) {
+		// the same address always interns to the same id, so an interned
+		// message can only match an interned handler address
+		if(id < m_ids.size()) {
+			entry = m_ids[id];
+		}
+	}
+	else {
+		std::unordered_map<std::string_view, Entry*>::const_iterator iter = m_entries.find(message.addressView());
+		if(iter != m_entries.end()) {
+			entry = iter->second;
+		}
+	}
+	if(!entry) {
+		return false;
+	}
+	lo_message msg = message.message();
+	const char *types = lo_message_get_types(msg);
+	lo_arg **argv = lo_message_get_argv(msg);
+	const std::vector<Handler> &handlers = entry->handlers;
+	for(unsigned int i = 0; i < handlers.size(); ++i) {
+		if(handlers[i].accepts(types) && handlers[i].call(argv, types)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// PRIVATE
+
+HandlerRegistry::Entry& HandlerRegistry::entry(std::string_view address) {
+	std::unordered_map<std::string_view, Entry*>::iterator iter = m_entries.find(address);
+	if(iter != m_entries.end()) {
+		return *iter->second;
+	}
+	Entry *entry = new Entry;
+	entry->address = address;
+	entry->id = AddressTable::intern(address);
+	m_entries[entry->address] = entry;
+	if(entry->id) {
+		if(entry->id >= m_ids.size()) {
+			m_ids.resize(entry->id + 1, NULL);
+		}
+		m_ids[entry->id] = entry;
+	}
+	return *entry;
+}
+
+} // namespace
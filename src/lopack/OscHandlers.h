@@ -0,0 +1,208 @@
+/*==============================================================================
+
+	OscHandlers.h
+
+	lopack: an oscpack-inspired C++ wrapper for liblo
+
+	Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================*/
+#pragma once
+
+#include "OscTypes.h"
+#include <functional>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace osc {
+
+/// \section Handler Arguments
+///
+/// maps a handler parameter type to the type tags it accepts & reads it from
+/// a liblo argument, the type tags are checked before any argument is read
+
+template <class T> struct HandlerArg {
+	static_assert(sizeof(T) == 0, "unsupported OSC handler argument type");
+};
+
+template <> struct HandlerArg<bool> {
+	static bool accepts(char tag) {return tag == LO_TRUE || tag == LO_FALSE;}
+	static bool read(lo_arg *arg, char tag) {return tag == LO_TRUE;}
+};
+
+template <> struct HandlerArg<char> {
+	static bool accepts(char tag) {return tag == LO_CHAR;}
+	static char read(lo_arg *arg, char tag) {return arg->c;}
+};
+
+template <> struct HandlerArg<Nil> {
+	static bool accepts(char tag) {return tag == LO_NIL;}
+	static Nil read(lo_arg *arg, char tag) {return Nil();}
+};
+
+template <> struct HandlerArg<Infinitum> {
+	static bool accepts(char tag) {return tag == LO_INFINITUM;}
+	static Infinitum read(lo_arg *arg, char tag) {return Infinitum();}
+};
+
+template <> struct HandlerArg<int32_t> {
+	static bool accepts(char tag) {return tag == LO_INT32;}
+	static int32_t read(lo_arg *arg, char tag) {return arg->i;}
+};
+
+template <> struct HandlerArg<int64_t> {
+	static bool accepts(char tag) {return tag == LO_INT64;}
+	static int64_t read(lo_arg *arg, char tag) {return arg->h;}
+};
+
+template <> struct HandlerArg<float> {
+	static bool accepts(char tag) {return tag == LO_FLOAT;}
+	static float read(lo_arg *arg, char tag) {return arg->f;}
+};
+
+template <> struct HandlerArg<double> {
+	static bool accepts(char tag) {return tag == LO_DOUBLE;}
+	static double read(lo_arg *arg, char tag) {return arg->d;}
+};
+
+/// strings are only valid during the call, copy to keep
+template <> struct HandlerArg<std::string_view> {
+	static bool accepts(char tag) {return tag == LO_STRING;}
+	static std::string_view read(lo_arg *arg, char tag) {return &arg->s;}
+};
+
+template <> struct HandlerArg<std::string> {
+	static bool accepts(char tag) {return tag == LO_STRING;}
+	static std::string read(lo_arg *arg, char tag) {return &arg->s;}
+};
+
+template <> struct HandlerArg<Symbol> {
+	static bool accepts(char tag) {return tag == LO_SYMBOL;}
+	static Symbol read(lo_arg *arg, char tag) {return Symbol(&arg->S);}
+};
+
+template <> struct HandlerArg<MidiMessage> {
+	static bool accepts(char tag) {return tag == LO_MIDI;}
+	static MidiMessage read(lo_arg *arg, char tag) {return MidiMessage(arg->m, true);} // rev byte order
+};
+
+template <> struct HandlerArg<TimeTag> {
+	static bool accepts(char tag) {return tag == LO_TIMETAG;}
+	static TimeTag read(lo_arg *arg, char tag) {return TimeTag(arg->t.sec, arg->t.frac);}
+};
+
+/// blob data is only valid during the call, copy to keep
+template <> struct HandlerArg<Blob> {
+	static bool accepts(char tag) {return tag == LO_BLOB;}
+	static Blob read(lo_arg *arg, char tag) {
+		return Blob(lo_blob_dataptr((lo_blob) arg), lo_blob_datasize((lo_blob) arg));
+	}
+};
+
+/// \class HandlerRegistry
+/// \brief typed message handlers indexed by address
+///
+/// each handler is registered with an exact address & the argument types of
+/// its parameters, ie. on<int32_t, float>("/synth/note", ...) only matches
+/// "/synth/note" messages with the type string "if"; handler addresses are
+/// interned, see AddressTable, so dispatch is an index by the message's
+/// address id, a type check, & a call with the decoded arguments
+///
+/// several handlers with different types may share an address & are tried in
+/// the order they were added; handlers return void (handled) or bool
+///
+/// note: addresses are matched exactly, OSC pattern wildcards in incoming
+///       addresses are not expanded
+class HandlerRegistry {
+
+	public:
+
+		HandlerRegistry() {}
+		virtual ~HandlerRegistry();
+
+		/// add a handler for an address called with the given argument types
+		template <class... Args, class Function>
+		void add(std::string_view address, Function &&function) {
+			Handler handler;
+			handler.accepts = &acceptsTypes<Args...>;
+			handler.call = [f = std::forward<Function>(function)](lo_arg **argv, const char *types) mutable -> bool {
+				return callWithArgs<Args...>(f, argv, types, std::index_sequence_for<Args...>());
+			};
+			entry(address).handlers.push_back(std::move(handler));
+		}
+
+		/// remove all handlers for an address
+		void remove(std::string_view address);
+
+		/// remove all handlers
+		void clear();
+
+		/// call the first handler matching the message address & types,
+		/// returns true if the message was handled
+		bool dispatch(const ReceivedMessage &message) const;
+
+		/// get the number of addresses with handlers
+		inline unsigned int size() const {return m_entries.size();}
+
+	private:
+
+		HandlerRegistry(HandlerRegistry const&);              // not copyable
+		HandlerRegistry& operator = (HandlerRegistry const&); // not assignable
+
+		/// a handler & its type check
+		struct Handler {
+			bool (*accepts)(const char *types);
+			std::function<bool(lo_arg **argv, const char *types)> call;
+		};
+
+		/// the handlers for an address, the map key views the address
+		struct Entry {
+			std::string address;
+			AddressId id; ///< interned address id, 0 if not interned
+			std::vector<Handler> handlers;
+		};
+
+		/// get or create the entry for an address
+		Entry& entry(std::string_view address);
+
+		/// does the type string match the argument types exactly?
+		template <class... Args>
+		static bool acceptsTypes(const char *types) {
+			unsigned int i = 0;
+			bool accepted = (... && HandlerArg<Args>::accepts(types[i++]));
+			return accepted && types[i] == '\0';
+		}
+
+		/// decode the arguments & call, void results count as handled
+		template <class... Args, class Function, size_t... I>
+		static bool callWithArgs(Function &f, lo_arg **argv, const char *types,
+		                         std::index_sequence<I...>) {
+			if constexpr(std::is_void<decltype(f(HandlerArg<Args>::read(argv[I], types[I])...))>::value) {
+				f(HandlerArg<Args>::read(argv[I], types[I])...);
+				return true;
+			}
+			else {
+				return f(HandlerArg<Args>::read(argv[I], types[I])...);
+			}
+		}
+
+		std::unordered_map<std::string_view, Entry*> m_entries; ///< handlers by address
+		std::vector<Entry*> m_ids; ///< handlers by interned address id, NULL if none
+};
+
+} // namespace
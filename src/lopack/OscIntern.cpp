@@ -0,0 +1,74 @@
+/*==============================================================================
+
+	OscIntern.cpp
+
+	lopack: an oscpack-inspired C++ wrapper for liblo
+
+	Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================*/
+#include "OscIntern.h"
+
+namespace osc {
+
+// a table slot, the id is its index + 1
+struct AddressSlot {
+	AddressKey key;
+};
+
+// table size, kept 3/4 full at most so probe runs stay short
+static const unsigned int NUM_SLOTS = 4096;
+
+// zero initialized, ie. all slots are empty before any static constructors run
+static AddressSlot s_slots[NUM_SLOTS];
+static std::atomic<unsigned int> s_size(0);
+
+AddressId AddressTable::intern(std::string_view address) {
+	return lookup(address, true);
+}
+
+AddressId AddressTable::find(std::string_view address) {
+	return lookup(address, false);
+}
+
+std::string_view AddressTable::address(AddressId id) {
+	if(id == 0 || id > NUM_SLOTS) {
+		return std::string_view();
+	}
+	const AddressKey &key = s_slots[id - 1].key;
+	if(key.state.load(std::memory_order_acquire) != SLOT_READY) {
+		return std::string_view();
+	}
+	return std::string_view(key.address, key.length);
+}
+
+unsigned int AddressTable::size() {
+	return s_size.load(std::memory_order_relaxed);
+}
+
+AddressId AddressTable::maxId() {
+	return NUM_SLOTS;
+}
+
+// PRIVATE
+
+AddressId AddressTable::lookup(std::string_view address, bool insert) {
+	AddressSlot *slot = findAddressSlot(s_slots, NUM_SLOTS, address, insert,
+	                                    &s_size, MAX_ADDRESSES);
+	return slot ? (slot - s_slots) + 1 : 0;
+}
+
+} // namespace
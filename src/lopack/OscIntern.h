@@ -0,0 +1,176 @@
+/*==============================================================================
+
+	OscIntern.h
+
+	lopack: an oscpack-inspired C++ wrapper for liblo
+
+	Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================*/
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <string_view>
+
+namespace osc {
+
+/// \section Hashing
+
+/// FNV-1a 64 bit hash of some bytes, pass a previous hash as the seed to
+/// hash several fields
+inline uint64_t hashBytes(const void *data, size_t size,
+                          uint64_t seed=14695981039346656037ULL) {
+	const unsigned char *bytes = (const unsigned char *) data;
+	uint64_t hash = seed;
+	for(size_t i = 0; i < size; ++i) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+/// FNV-1a 64 bit hash of a string, ie. an address
+inline uint64_t hashString(std::string_view string) {
+	return hashBytes(string.data(), string.size());
+}
+
+/// interned address id, 0 if the address is not interned
+typedef uint32_t AddressId;
+
+/// \class AddressTable
+/// \brief global lock-free table of interned osc addresses
+///
+/// interning resolves an address to a small integer id & a stable copy of
+/// the address which is never freed, so dispatch code can compare & index by
+/// id instead of comparing strings; addresses are interned when registered,
+/// ie. by handlers or a StateStore, while ReceivedMessage only looks up its
+/// address with find(), so arbitrary received addresses cannot fill the table
+///
+/// the table is a fixed-size open addressing hash table allocated up front,
+/// so lookups & inserts never lock or allocate; addresses which are too long
+/// or arrive once the table is full are not interned & get id 0, callers
+/// then fall back to comparing strings
+class AddressTable {
+
+	public:
+
+		/// max address length, longer addresses are not interned
+		static const unsigned int MAX_ADDRESS_LEN = 128;
+
+		/// max number of interned addresses
+		static const unsigned int MAX_ADDRESSES = 3072;
+
+		/// get the id for an address, interning it if needed,
+		/// returns 0 if the address is too long or the table is full
+		static AddressId intern(std::string_view address);
+
+		/// get the id for an address without interning, 0 if not interned
+		static AddressId find(std::string_view address);
+
+		/// get the stable interned address for an id, empty for 0 or an unused id
+		static std::string_view address(AddressId id);
+
+		/// get the number of interned addresses
+		static unsigned int size();
+
+		/// get the max id, ie. to size an id indexed array
+		static AddressId maxId();
+
+	private:
+
+		AddressTable() {} // static only
+
+		/// find or claim the slot for an address, returns 0 if not found
+		static AddressId lookup(std::string_view address, bool insert);
+};
+
+/// \section Address Slots
+///
+/// fixed-size, lock-free open addressing tables keyed by address, shared by
+/// AddressTable & ReceiveMetrics; a slot is claimed once by writing its key
+/// & is never freed, so readers only wait while a key is being written
+
+/// address slot states
+enum AddressSlotState {
+	SLOT_EMPTY,
+	SLOT_CLAIMED, ///< key being written
+	SLOT_READY
+};
+
+/// the key of an address table slot, zero initialized is empty
+struct AddressKey {
+	std::atomic<unsigned int> state; ///< AddressSlotState
+	std::atomic<uint64_t> hash;      ///< address hash, set before ready
+	unsigned int length;             ///< address length
+	char address[AddressTable::MAX_ADDRESS_LEN]; ///< NULL terminated address
+};
+
+/// find the slot for an address in a table of slots with an AddressKey
+/// "key" member, or claim an empty one if insert is set; size counts the
+/// claimed slots & stops claiming at maxSize, if given; safe to call from
+/// any thread, returns NULL if the address is too long or not found or the
+/// table is full
+template <class Slot>
+Slot* findAddressSlot(Slot *slots, unsigned int numSlots, std::string_view address,
+                      bool insert, std::atomic<unsigned int> *size=NULL,
+                      unsigned int maxSize=0) {
+	if(address.size() >= AddressTable::MAX_ADDRESS_LEN) {
+		return NULL;
+	}
+	uint64_t hash = hashString(address);
+	unsigned int start = hash % numSlots;
+	for(unsigned int i = 0; i < numSlots; ++i) {
+		Slot &slot = slots[(start + i) % numSlots];
+		AddressKey &key = slot.key;
+		unsigned int state = key.state.load(std::memory_order_acquire);
+		if(state == SLOT_EMPTY) { // slots are never freed, so the address isn't further along
+			if(!insert) {
+				return NULL;
+			}
+			// reserve room first, the table stops growing when full
+			if(size && size->fetch_add(1, std::memory_order_relaxed) >= maxSize) {
+				size->fetch_sub(1, std::memory_order_relaxed);
+				return NULL;
+			}
+			// try to claim, another thread may beat us to it
+			if(key.state.compare_exchange_strong(state, SLOT_CLAIMED,
+			                                     std::memory_order_acq_rel)) {
+				memcpy(key.address, address.data(), address.size());
+				key.address[address.size()] = '\0';
+				key.length = address.size();
+				key.hash.store(hash, std::memory_order_relaxed);
+				key.state.store(SLOT_READY, std::memory_order_release);
+				return &slot;
+			}
+			if(size) {
+				size->fetch_sub(1, std::memory_order_relaxed);
+			}
+		}
+		while(state == SLOT_CLAIMED) { // key is being written, wait for it
+			state = key.state.load(std::memory_order_acquire);
+		}
+		if(state == SLOT_READY && key.hash.load(std::memory_order_relaxed) == hash &&
+		   address == std::string_view(key.address, key.length)) {
+			return &slot;
+		}
+	}
+	return NULL;
+}
+
+} // namespace
@@ -0,0 +1,212 @@
+/*==============================================================================
+
+	OscLanes.cpp
+
+	lopack: an oscpack-inspired C++ wrapper for liblo
+
+	Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================*/
+#include "OscLanes.h"
+
+#include "Log.h"
+#include <algorithm>
+#include <new>
+
+namespace osc {
+
+PriorityLanes::PriorityLanes(unsigned int numLanes, unsigned int capacity) :
+	m_defaultLane(0), m_scheduling(STRICT), m_current(0), m_credit(0), m_popped(NULL),
+	m_waiting(false) {
+	numLanes = std::max(numLanes, 1U);
+	unsigned int size = 1;
+	while(size < capacity) {
+		size <<= 1;
+	}
+	for(unsigned int i = 0; i < numLanes; ++i) {
+		Lane *lane = new Lane;
+		lane->items = (Item *) ::operator new(size * sizeof(Item)); // raw storage
+		lane->mask = size - 1;
+		m_lanes.push_back(lane);
+	}
+	m_defaultLane = numLanes - 1;
+}
+
+PriorityLanes::~PriorityLanes() {
+	for(unsigned int i = 0; i < m_lanes.size(); ++i) {
+		while(front(*m_lanes[i]) != NULL) {
+			m_popped = m_lanes[i];
+			release();
+		}
+		::operator delete(m_lanes[i]->items);
+		delete m_lanes[i];
+	}
+}
+
+// SETUP
+
+void PriorityLanes::setPrefix(const std::string &prefix, unsigned int lane) {
+	if(lane >= m_lanes.size()) {
+		LOG_WARN << "PriorityLanes: cannot set prefix, lane " << lane << " out of range" << std::endl;
+		return;
+	}
+	for(unsigned int i = 0; i < m_prefixes.size(); ++i) {
+		if(m_prefixes[i].first == prefix) {
+			m_prefixes[i].second = lane;
+			return;
+		}
+	}
+	m_prefixes.push_back(std::make_pair(prefix, lane));
+}
+
+void PriorityLanes::setDefaultLane(unsigned int lane) {
+	if(lane >= m_lanes.size()) {
+		LOG_WARN << "PriorityLanes: cannot set default lane, lane " << lane << " out of range" << std::endl;
+		return;
+	}
+	m_defaultLane = lane;
+}
+
+void PriorityLanes::setWeight(unsigned int lane, unsigned int weight) {
+	if(lane >= m_lanes.size()) {
+		LOG_WARN << "PriorityLanes: cannot set weight, lane " << lane << " out of range" << std::endl;
+		return;
+	}
+	m_lanes[lane]->weight = std::max(weight, 1U);
+}
+
+void PriorityLanes::setScheduling(Scheduling scheduling) {
+	m_scheduling = scheduling;
+	m_current = 0;
+	m_credit = 0;
+}
+
+// QUEUEING
+
+unsigned int PriorityLanes::classify(std::string_view address) const {
+	unsigned int lane = m_defaultLane;
+	std::string_view::size_type longest = 0;
+	for(unsigned int i = 0; i < m_prefixes.size(); ++i) {
+		const std::string &prefix = m_prefixes[i].first;
+		if(prefix.size() >= longest && address.substr(0, prefix.size()) == prefix) {
+			lane = m_prefixes[i].second;
+			longest = prefix.size();
+		}
+	}
+	return lane;
+}
+
+bool PriorityLanes::push(const ReceivedMessage &message, const MessageSource &source) {
+	Lane &lane = *m_lanes[classify(message.addressView())];
+	uint64_t tail = lane.tail.load(std::memory_order_relaxed);
+	if(tail - lane.head.load(std::memory_order_acquire) > lane.mask) {
+		lane.dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	new (&lane.items[tail & lane.mask]) Item(message, source);
+	lane.tail.store(tail + 1, std::memory_order_seq_cst);
+	if(m_waiting.load(std::memory_order_seq_cst)) {
+		wake();
+	}
+	return true;
+}
+
+PriorityLanes::Item* PriorityLanes::pop() {
+	release();
+	if(m_scheduling == STRICT) {
+		for(unsigned int i = 0; i < m_lanes.size(); ++i) {
+			Item *item = front(*m_lanes[i]);
+			if(item) {
+				m_popped = m_lanes[i];
+				return item;
+			}
+		}
+		return NULL;
+	}
+
+	// weighted round robin, skip empty lanes
+	for(unsigned int tries = 0; tries <= m_lanes.size(); ++tries) {
+		if(m_credit == 0) {
+			m_current = (m_current + 1) % m_lanes.size();
+			m_credit = m_lanes[m_current]->weight;
+		}
+		Item *item = front(*m_lanes[m_current]);
+		if(item) {
+			m_credit--;
+			m_popped = m_lanes[m_current];
+			return item;
+		}
+		m_credit = 0;
+	}
+	return NULL;
+}
+
+void PriorityLanes::release() {
+	if(!m_popped) {
+		return;
+	}
+	Lane &lane = *m_popped;
+	uint64_t head = lane.head.load(std::memory_order_relaxed);
+	lane.items[head & lane.mask].~Item();
+	lane.head.store(head + 1, std::memory_order_release); // slot can be reused
+	m_popped = NULL;
+}
+
+void PriorityLanes::wait(std::chrono::milliseconds timeout) {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_waiting.store(true, std::memory_order_seq_cst);
+	for(unsigned int i = 0; i < m_lanes.size(); ++i) { // recheck after flagging
+		Lane &lane = *m_lanes[i];
+		if(lane.head.load(std::memory_order_relaxed) != lane.tail.load(std::memory_order_seq_cst)) {
+			m_waiting.store(false);
+			return;
+		}
+	}
+	m_condition.wait_for(lock, timeout);
+	m_waiting.store(false);
+}
+
+void PriorityLanes::wake() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_condition.notify_one();
+}
+
+LaneStats PriorityLanes::getStats(unsigned int lane) const {
+	LaneStats stats;
+	if(lane >= m_lanes.size()) {
+		return stats;
+	}
+	const Lane &l = *m_lanes[lane];
+	uint64_t head = l.head.load(std::memory_order_acquire);
+	uint64_t tail = l.tail.load(std::memory_order_acquire);
+	stats.dispatched = head;
+	stats.queued = tail;
+	stats.dropped = l.dropped.load(std::memory_order_relaxed);
+	stats.depth = (unsigned int) (tail - head);
+	return stats;
+}
+
+// PRIVATE
+
+PriorityLanes::Item* PriorityLanes::front(Lane &lane) {
+	uint64_t head = lane.head.load(std::memory_order_relaxed);
+	if(head == lane.tail.load(std::memory_order_acquire)) {
+		return NULL;
+	}
+	return &lane.items[head & lane.mask];
+}
+
+} // namespace
@@ -0,0 +1,159 @@
+/*==============================================================================
+
+	OscLanes.h
+
+	lopack: an oscpack-inspired C++ wrapper for liblo
+
+	Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================*/
+#pragma once
+
+#include "OscTypes.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+namespace osc {
+
+/// per lane counters
+struct LaneStats {
+	uint64_t queued;     ///< messages queued
+	uint64_t dispatched; ///< messages taken from the queue for dispatch
+	uint64_t dropped;    ///< messages shed because the queue was full
+	unsigned int depth;  ///< messages currently queued
+
+	LaneStats() : queued(0), dispatched(0), dropped(0), depth(0) {}
+};
+
+/// \class PriorityLanes
+/// \brief bounded per-priority message queues for an OscReceiver
+///
+/// messages are classified into lanes by the longest matching address
+/// prefix, lane 0 is the highest priority; each lane is a lock-free single
+/// producer, single consumer queue between the receive thread & the
+/// dispatch thread
+///
+/// a full lane sheds new messages, so under overload low priority lanes
+/// fill & drop first while high priority lanes keep dispatching
+class PriorityLanes {
+
+	public:
+
+		/// lane scheduling
+		enum Scheduling {
+			STRICT,  ///< always dispatch from the highest priority non-empty lane
+			WEIGHTED ///< dispatch up to each lane's weight in turn
+		};
+
+		/// a queued message, which clones the liblo message so only the
+		/// dispatch thread references it, see ReceivedMessage::clone()
+		struct Item {
+			ReceivedMessage message;
+			MessageSource source;
+			Item(const ReceivedMessage &m, const MessageSource &s) : message(m.clone()), source(s) {}
+		};
+
+		/// set the number of lanes & the max queued messages per lane,
+		/// rounded up to a power of 2
+		PriorityLanes(unsigned int numLanes, unsigned int capacity=1024);
+		virtual ~PriorityLanes();
+
+	/// \section Setup
+	///
+	/// note: not thread safe, set up before starting the receiver
+
+		/// route messages starting with prefix to a lane
+		void setPrefix(const std::string &prefix, unsigned int lane);
+
+		/// set the lane for messages which don't match a prefix,
+		/// default: the lowest priority lane
+		void setDefaultLane(unsigned int lane);
+
+		/// set a lane's weight for weighted scheduling, default 1
+		void setWeight(unsigned int lane, unsigned int weight);
+
+		/// set the scheduling, default STRICT
+		void setScheduling(Scheduling scheduling);
+
+		/// get the number of lanes
+		inline unsigned int getNumLanes() const {return m_lanes.size();}
+
+	/// \section Queueing
+
+		/// get the lane for an address
+		unsigned int classify(std::string_view address) const;
+
+		/// queue a message, called from the receive thread only,
+		/// returns false if the lane was full & the message dropped
+		bool push(const ReceivedMessage &message, const MessageSource &source);
+
+		/// get the next message to dispatch, called from the dispatch thread
+		/// only, returns NULL if all lanes are empty; the item stays in its
+		/// lane's ring until release() or the next pop()
+		Item* pop();
+
+		/// release the last popped item once it has been dispatched, called
+		/// from the dispatch thread only
+		void release();
+
+		/// wait until a message is queued or the timeout expires
+		void wait(std::chrono::milliseconds timeout);
+
+		/// wake any waiting dispatch thread
+		void wake();
+
+		/// get the counters for a lane, safe to call from any thread
+		LaneStats getStats(unsigned int lane) const;
+
+	private:
+
+		PriorityLanes(PriorityLanes const&);              // not copyable
+		PriorityLanes& operator = (PriorityLanes const&); // not assignable
+
+		/// a single producer, single consumer ring of items, allocated up
+		/// front so queueing only copies the message & source into a slot
+		struct Lane {
+			Item *items;         ///< ring buffer storage, items are constructed in place
+			uint64_t mask;       ///< capacity - 1
+			unsigned int weight; ///< weighted scheduling weight
+			std::atomic<uint64_t> head; ///< next to pop
+			char padding[64];           ///< keep head & tail on separate cache lines
+			std::atomic<uint64_t> tail; ///< next to push
+			std::atomic<uint64_t> dropped; ///< shed messages
+			Lane() : items(NULL), mask(0), weight(1), head(0), tail(0), dropped(0) {}
+		};
+
+		/// get the first item in a lane, NULL if empty
+		Item* front(Lane &lane);
+
+		std::vector<Lane*> m_lanes; ///< lanes in priority order
+		std::vector<std::pair<std::string, unsigned int> > m_prefixes; ///< prefix routes
+		unsigned int m_defaultLane; ///< lane for unmatched addresses
+		Scheduling m_scheduling;    ///< scheduling mode
+
+		unsigned int m_current; ///< current lane for weighted scheduling
+		unsigned int m_credit;  ///< messages left for the current lane
+		Lane *m_popped;         ///< lane of the popped item, NULL if released
+
+		std::mutex m_mutex;                 ///< for waiting only
+		std::condition_variable m_condition; ///< signals queued messages
+		std::atomic<bool> m_waiting;        ///< is the dispatch thread waiting?
+};
+
+} // namespace
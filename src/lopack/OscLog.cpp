@@ -0,0 +1,233 @@
+/*==============================================================================
+
+	OscLog.cpp
+
+	lopack: an oscpack-inspired C++ wrapper for liblo
+
+	Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================*/
+#include "OscLog.h"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <string.h>
+
+namespace osc {
+
+// number of queued lines, must be a power of 2
+static const size_t LOG_QUEUE_SIZE = 1024;
+
+// how often the background thread writes queued lines
+static const std::chrono::milliseconds LOG_WRITE_INTERVAL(10);
+
+// lines dropped because the queue was full
+static std::atomic<unsigned long> s_dropped(0);
+
+// set once the log thread has been stopped at exit, lines logged from static
+// destructors after that are written directly
+static std::atomic<bool> s_shutdown(false);
+
+// prints normal & debug lines to std::cout, warn & error lines to std::cerr
+static void defaultSink(LogLevel level, const char *line, size_t length, void *userData) {
+	switch(level) {
+		case LOG_LEVEL_DEBUG:
+			std::cout << "Debug: ";
+			std::cout.write(line, length).flush();
+			break;
+		case LOG_LEVEL_NORMAL:
+			std::cout.write(line, length).flush();
+			break;
+		case LOG_LEVEL_WARN:
+			std::cerr << "Warn: ";
+			std::cerr.write(line, length);
+			break;
+		case LOG_LEVEL_ERROR:
+			std::cerr << "Error: ";
+			std::cerr.write(line, length);
+			break;
+	}
+}
+
+/// bounded multi-producer multi-consumer line queue, each slot's sequence
+/// number says whether it is free for the producer or full for the consumer
+/// at the current position, see Dmitry Vyukov's bounded MPMC queue
+class LogQueue {
+
+	public:
+
+		LogQueue() : m_head(0), m_tail(0) {
+			for(size_t i = 0; i < LOG_QUEUE_SIZE; ++i) {
+				m_slots[i].sequence.store(i, std::memory_order_relaxed);
+			}
+		}
+
+		/// copy a line into the queue, returns false if full
+		bool push(LogLevel level, const char *line, size_t length) {
+			size_t pos = m_tail.load(std::memory_order_relaxed);
+			Slot *slot;
+			while(true) {
+				slot = &m_slots[pos & (LOG_QUEUE_SIZE - 1)];
+				size_t seq = slot->sequence.load(std::memory_order_acquire);
+				intptr_t diff = (intptr_t) seq - (intptr_t) pos;
+				if(diff == 0) {
+					if(m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+						break;
+					}
+				}
+				else if(diff < 0) {
+					return false; // full
+				}
+				else {
+					pos = m_tail.load(std::memory_order_relaxed);
+				}
+			}
+			slot->level = level;
+			slot->length = length < LOG_LINE_SIZE ? length : LOG_LINE_SIZE;
+			memcpy(slot->line, line, slot->length);
+			slot->sequence.store(pos + 1, std::memory_order_release);
+			return true;
+		}
+
+		/// pass the oldest line to the sink & remove it, returns false if empty
+		bool pop(LogSink sink, void *userData) {
+			size_t pos = m_head.load(std::memory_order_relaxed);
+			Slot *slot;
+			while(true) {
+				slot = &m_slots[pos & (LOG_QUEUE_SIZE - 1)];
+				size_t seq = slot->sequence.load(std::memory_order_acquire);
+				intptr_t diff = (intptr_t) seq - (intptr_t) (pos + 1);
+				if(diff == 0) {
+					if(m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+						break;
+					}
+				}
+				else if(diff < 0) {
+					return false; // empty
+				}
+				else {
+					pos = m_head.load(std::memory_order_relaxed);
+				}
+			}
+			sink(slot->level, slot->line, slot->length, userData);
+			slot->sequence.store(pos + LOG_QUEUE_SIZE, std::memory_order_release);
+			return true;
+		}
+
+	private:
+
+		struct Slot {
+			std::atomic<size_t> sequence;
+			LogLevel level;
+			size_t length;
+			char line[LOG_LINE_SIZE];
+		};
+
+		Slot m_slots[LOG_QUEUE_SIZE];
+		alignas(64) std::atomic<size_t> m_head; ///< consumer position
+		alignas(64) std::atomic<size_t> m_tail; ///< producer position
+};
+
+/// the queue, sink, & background thread, created on first use
+class LogWriter {
+
+	public:
+
+		LogWriter() : m_sink(defaultSink), m_userData(NULL), m_running(true) {
+			m_thread = std::thread(&LogWriter::run, this);
+		}
+
+		~LogWriter() {
+			m_running.store(false);
+			m_thread.join();
+			write();
+			s_shutdown.store(true);
+		}
+
+		/// write all queued lines to the sink
+		void write() {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			while(queue.pop(m_sink, m_userData)) {}
+		}
+
+		/// set the sink, NULL restores the default
+		void setSink(LogSink sink, void *userData) {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			while(queue.pop(m_sink, m_userData)) {} // finish with the old sink
+			m_sink = sink ? sink : defaultSink;
+			m_userData = sink ? userData : NULL;
+		}
+
+		LogQueue queue;
+
+	private:
+
+		/// background thread loop
+		void run() {
+			while(m_running.load()) {
+				std::this_thread::sleep_for(LOG_WRITE_INTERVAL);
+				write();
+			}
+		}
+
+		std::mutex m_mutex;  ///< serializes sink calls & changes
+		LogSink m_sink;      ///< current sink
+		void *m_userData;    ///< sink user data
+		std::atomic<bool> m_running; ///< keep the thread running?
+		std::thread m_thread;        ///< background thread
+};
+
+static LogWriter& writer() {
+	static LogWriter s_writer;
+	return s_writer;
+}
+
+// LOG
+
+void setLogSink(LogSink sink, void *userData) {
+	writer().setSink(sink, userData);
+}
+
+void flushLog() {
+	if(s_shutdown.load()) {
+		return;
+	}
+	writer().write();
+}
+
+unsigned long getNumDroppedLogLines() {
+	return s_dropped.load(std::memory_order_relaxed);
+}
+
+bool logLine(LogLevel level, const char *line, size_t length) {
+	if(length == 0) {
+		return true;
+	}
+	if(s_shutdown.load(std::memory_order_relaxed)) {
+		defaultSink(level, line, length, NULL);
+		return true;
+	}
+	if(!writer().queue.push(level, line, length)) {
+		s_dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	return true;
+}
+
+} // namespace
@@ -0,0 +1,68 @@
+/*==============================================================================
+
+	OscLog.h
+
+	lopack: an oscpack-inspired C++ wrapper for liblo
+
+	Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================*/
+#pragma once
+
+#include <stddef.h>
+
+namespace osc {
+
+/// \section Logging
+///
+/// lopack log lines are queued in a lock-free ring buffer & written by a
+/// background thread, so logging never blocks the receive thread on a
+/// terminal or file write; lines are dropped if the buffer is full
+///
+/// levels below LOPACK_LOG_MIN_LEVEL are removed at compile time when
+/// building the library: 0 debug, 1 normal, 2 warn, 3 error, 4 none,
+/// the default is 0 for debug builds & 1 otherwise
+
+/// log levels, in order of severity
+enum LogLevel {
+	LOG_LEVEL_DEBUG,
+	LOG_LEVEL_NORMAL,
+	LOG_LEVEL_WARN,
+	LOG_LEVEL_ERROR
+};
+
+/// max log line length in bytes, longer lines are truncated
+static const size_t LOG_LINE_SIZE = 256;
+
+/// log sink callback, called on the background log thread with a line of
+/// text & its length, lines include any trailing newline
+typedef void (*LogSink)(LogLevel level, const char *line, size_t length, void *userData);
+
+/// set the log sink, NULL restores the default which prints normal & debug
+/// lines to std::cout and warn & error lines to std::cerr
+void setLogSink(LogSink sink, void *userData=NULL);
+
+/// write all queued log lines to the sink now, on the calling thread
+void flushLog();
+
+/// get the number of log lines dropped because the log buffer was full
+unsigned long getNumDroppedLogLines();
+
+/// queue a log line, safe to call from any thread & never blocks,
+/// returns false if the line was dropped
+bool logLine(LogLevel level, const char *line, size_t length);
+
+} // namespace
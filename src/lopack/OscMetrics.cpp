@@ -0,0 +1,331 @@
+/*==============================================================================
+
+	OscMetrics.cpp
+
+	lopack: an oscpack-inspired C++ wrapper for liblo
+
+	Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================*/
+#include "OscMetrics.h"
+
+#include "OscSender.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string.h>
+
+namespace osc {
+
+// shorthand for relaxed atomic ops, counters don't need ordering
+static const std::memory_order relaxed = std::memory_order_relaxed;
+
+// LATENCY SUMMARY
+
+static void printSummary(const LatencySummary &s) {
+	std::cout << "count " << s.count << " mean " << (uint64_t) s.mean
+	          << " p50 " << s.p50 << " p99 " << s.p99
+	          << " max " << s.max << " ns";
+}
+
+void MetricsSnapshot::print() const {
+	std::cout << "received " << received << " handled " << handled
+	          << " unhandled " << unhandled << " ignored " << ignored
+	          << " overflow " << overflow << " in " << seconds << "s ("
+	          << rate() << " msgs/s)" << std::endl;
+	std::cout << "  latency: ";
+	printSummary(latency);
+	std::cout << std::endl;
+	for(unsigned int i = 0; i < addresses.size(); ++i) {
+		std::cout << "  " << addresses[i].address << ": received "
+		          << addresses[i].received << " handled " << addresses[i].handled
+		          << ", ";
+		printSummary(addresses[i].latency);
+		std::cout << std::endl;
+	}
+	for(unsigned int i = 0; i < objects.size(); ++i) {
+		std::cout << "  object " << objects[i].object << " "
+		          << objects[i].rootAddress << ": calls " << objects[i].calls
+		          << " handled " << objects[i].handled << ", ";
+		printSummary(objects[i].latency);
+		std::cout << std::endl;
+	}
+}
+
+// LATENCY HISTOGRAM
+
+LatencyHistogram::LatencyHistogram() {
+	reset();
+}
+
+void LatencyHistogram::record(uint64_t ns) {
+	m_buckets[bucketIndex(ns)].fetch_add(1, relaxed);
+	m_count.fetch_add(1, relaxed);
+	m_sum.fetch_add(ns, relaxed);
+	uint64_t min = m_min.load(relaxed);
+	while(ns < min && !m_min.compare_exchange_weak(min, ns, relaxed)) {}
+	uint64_t max = m_max.load(relaxed);
+	while(ns > max && !m_max.compare_exchange_weak(max, ns, relaxed)) {}
+}
+
+void LatencyHistogram::reset() {
+	for(unsigned int i = 0; i < NUM_BUCKETS; ++i) {
+		m_buckets[i].store(0, relaxed);
+	}
+	m_count.store(0, relaxed);
+	m_sum.store(0, relaxed);
+	m_min.store(UINT64_MAX, relaxed);
+	m_max.store(0, relaxed);
+}
+
+LatencySummary LatencyHistogram::summary() const {
+	LatencySummary s;
+
+	// copy buckets first so the percentiles are consistent
+	uint64_t buckets[NUM_BUCKETS];
+	uint64_t count = 0;
+	for(unsigned int i = 0; i < NUM_BUCKETS; ++i) {
+		buckets[i] = m_buckets[i].load(relaxed);
+		count += buckets[i];
+	}
+	if(count == 0) {
+		return s;
+	}
+	s.count = count;
+	s.min = m_min.load(relaxed);
+	s.max = m_max.load(relaxed);
+	s.mean = (double) m_sum.load(relaxed) / (double) m_count.load(relaxed);
+
+	// walk buckets until each percentile's rank is reached
+	const double percentiles[4] = {0.5, 0.9, 0.99, 0.999};
+	uint64_t *values[4] = {&s.p50, &s.p90, &s.p99, &s.p999};
+	unsigned int p = 0;
+	uint64_t seen = 0;
+	for(unsigned int i = 0; i < NUM_BUCKETS && p < 4; ++i) {
+		seen += buckets[i];
+		while(p < 4 && seen >= (uint64_t)(percentiles[p] * count + 0.5) && seen > 0) {
+			*values[p] = std::min(bucketValue(i), s.max);
+			p++;
+		}
+	}
+	return s;
+}
+
+unsigned int LatencyHistogram::bucketIndex(uint64_t ns) {
+	if(ns < SUB_BUCKETS) {
+		return (unsigned int) ns; // exact
+	}
+	unsigned int msb = 63;
+	while(!(ns & (1ULL << msb))) {msb--;}
+	unsigned int magnitude = msb - SUB_BUCKET_BITS + 1;
+	if(magnitude >= MAGNITUDES) {
+		return NUM_BUCKETS - 1; // clamp
+	}
+	unsigned int sub = (ns >> (msb - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+	return magnitude * SUB_BUCKETS + sub;
+}
+
+uint64_t LatencyHistogram::bucketValue(unsigned int index) {
+	unsigned int magnitude = index / SUB_BUCKETS;
+	unsigned int sub = index % SUB_BUCKETS;
+	if(magnitude == 0) {
+		return sub;
+	}
+	uint64_t lower = (uint64_t)(SUB_BUCKETS + sub) << (magnitude - 1);
+	return lower + (1ULL << (magnitude - 1)) - 1;
+}
+
+// RECEIVE METRICS
+
+ReceiveMetrics::ReceiveMetrics(unsigned int maxAddresses, unsigned int maxObjects) :
+	m_maxAddresses(maxAddresses > 0 ? maxAddresses : 1),
+	m_maxObjects(maxObjects > 0 ? maxObjects : 1) {
+	m_addresses = new AddressSlot[m_maxAddresses];
+	m_objects = new ObjectSlot[m_maxObjects];
+	m_received.store(0);
+	m_handled.store(0);
+	m_ignored.store(0);
+	m_overflow.store(0);
+	m_startTime.store(now());
+}
+
+ReceiveMetrics::~ReceiveMetrics() {
+	delete[] m_addresses;
+	delete[] m_objects;
+}
+
+// RECORDING
+
+void ReceiveMetrics::recordIgnored() {
+	m_ignored.fetch_add(1, relaxed);
+}
+
+void ReceiveMetrics::recordMessage(std::string_view address, bool handled, uint64_t ns) {
+	m_received.fetch_add(1, relaxed);
+	if(handled) {
+		m_handled.fetch_add(1, relaxed);
+	}
+	m_latency.record(ns);
+	AddressSlot *slot = addressSlot(address);
+	if(!slot) {
+		m_overflow.fetch_add(1, relaxed);
+		return;
+	}
+	slot->received.fetch_add(1, relaxed);
+	if(handled) {
+		slot->handled.fetch_add(1, relaxed);
+	}
+	slot->latency.record(ns);
+}
+
+void ReceiveMetrics::recordObject(const OscObject *object, const std::string &rootAddress,
+                                  bool handled, uint64_t ns) {
+	ObjectSlot *slot = objectSlot(object, rootAddress);
+	if(!slot) {
+		return;
+	}
+	slot->calls.fetch_add(1, relaxed);
+	if(handled) {
+		slot->handled.fetch_add(1, relaxed);
+	}
+	slot->latency.record(ns);
+}
+
+// READING
+
+MetricsSnapshot ReceiveMetrics::snapshot() const {
+	MetricsSnapshot s;
+	s.seconds = (now() - m_startTime.load(relaxed)) * 0.000000001;
+	s.received = m_received.load(relaxed);
+	s.handled = m_handled.load(relaxed);
+	s.unhandled = s.received - s.handled;
+	s.ignored = m_ignored.load(relaxed);
+	s.overflow = m_overflow.load(relaxed);
+	s.latency = m_latency.summary();
+	for(unsigned int i = 0; i < m_maxAddresses; ++i) {
+		const AddressSlot &slot = m_addresses[i];
+		if(slot.key.state.load(std::memory_order_acquire) != SLOT_READY) {
+			continue;
+		}
+		AddressMetrics a;
+		a.address = slot.key.address;
+		a.received = slot.received.load(relaxed);
+		a.handled = slot.handled.load(relaxed);
+		a.latency = slot.latency.summary();
+		s.addresses.push_back(a);
+	}
+	for(unsigned int i = 0; i < m_maxObjects; ++i) {
+		const ObjectSlot &slot = m_objects[i];
+		if(slot.state.load(std::memory_order_acquire) != SLOT_READY) {
+			continue;
+		}
+		ObjectMetrics o;
+		o.object = slot.object.load(relaxed);
+		o.rootAddress = slot.rootAddress;
+		o.calls = slot.calls.load(relaxed);
+		o.handled = slot.handled.load(relaxed);
+		o.latency = slot.latency.summary();
+		s.objects.push_back(o);
+	}
+	return s;
+}
+
+void ReceiveMetrics::reset() {
+	m_received.store(0, relaxed);
+	m_handled.store(0, relaxed);
+	m_ignored.store(0, relaxed);
+	m_overflow.store(0, relaxed);
+	m_latency.reset();
+	for(unsigned int i = 0; i < m_maxAddresses; ++i) {
+		m_addresses[i].received.store(0, relaxed);
+		m_addresses[i].handled.store(0, relaxed);
+		m_addresses[i].latency.reset();
+	}
+	for(unsigned int i = 0; i < m_maxObjects; ++i) {
+		m_objects[i].calls.store(0, relaxed);
+		m_objects[i].handled.store(0, relaxed);
+		m_objects[i].latency.reset();
+	}
+	m_startTime.store(now(), relaxed);
+}
+
+void ReceiveMetrics::publish(OscSender &sender, const std::string &address) const {
+	MetricsSnapshot s = snapshot();
+	sender << BeginBundle();
+	sender << BeginMessage(address + "/totals")
+	       << (int64_t) s.received << (int64_t) s.handled << (int64_t) s.unhandled
+	       << (int64_t) s.ignored << (int64_t) s.overflow << (float) s.rate()
+	       << EndMessage();
+	for(unsigned int i = 0; i < s.addresses.size(); ++i) {
+		const AddressMetrics &a = s.addresses[i];
+		sender << BeginMessage(address + "/address")
+		       << a.address << (int64_t) a.received << (int64_t) a.handled
+		       << (int64_t) a.latency.p50 << (int64_t) a.latency.p99
+		       << (int64_t) a.latency.max
+		       << EndMessage();
+	}
+	for(unsigned int i = 0; i < s.objects.size(); ++i) {
+		const ObjectMetrics &o = s.objects[i];
+		sender << BeginMessage(address + "/object")
+		       << o.rootAddress << (int64_t) o.calls << (int64_t) o.handled
+		       << (int64_t) o.latency.p50 << (int64_t) o.latency.p99
+		       << (int64_t) o.latency.max
+		       << EndMessage();
+	}
+	sender << EndBundle();
+	sender.send();
+}
+
+// UTIL
+
+uint64_t ReceiveMetrics::now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// PRIVATE
+
+ReceiveMetrics::AddressSlot* ReceiveMetrics::addressSlot(std::string_view address) {
+	// another dispatch thread may claim the same slot, it is then reused
+	return findAddressSlot(m_addresses, m_maxAddresses, address, true);
+}
+
+ReceiveMetrics::ObjectSlot* ReceiveMetrics::objectSlot(const OscObject *object,
+                                                       const std::string &rootAddress) {
+	for(unsigned int i = 0; i < m_maxObjects; ++i) {
+		ObjectSlot &slot = m_objects[i];
+		unsigned int state = slot.state.load(std::memory_order_acquire);
+		if(state == SLOT_EMPTY) {
+			if(slot.state.compare_exchange_strong(state, SLOT_CLAIMED,
+			                                      std::memory_order_acq_rel)) {
+				strncpy(slot.rootAddress, rootAddress.c_str(), MAX_ADDRESS_LEN - 1);
+				slot.rootAddress[MAX_ADDRESS_LEN - 1] = '\0';
+				slot.object.store(object, relaxed);
+				slot.state.store(SLOT_READY, std::memory_order_release);
+				return &slot;
+			}
+		}
+		while(state == SLOT_CLAIMED) {
+			state = slot.state.load(std::memory_order_acquire);
+		}
+		if(slot.object.load(relaxed) == object) {
+			return &slot;
+		}
+	}
+	return NULL;
+}
+
+} // namespace
@@ -0,0 +1,232 @@
+/*==============================================================================
+
+	OscMetrics.h
+
+	lopack: an oscpack-inspired C++ wrapper for liblo
+
+	Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================*/
+#pragma once
+
+#include "OscIntern.h"
+
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <stdint.h>
+
+namespace osc {
+
+class OscObject;
+class OscSender;
+
+/// \section Metrics Snapshots
+
+/// latency statistics in nanoseconds
+struct LatencySummary {
+	uint64_t count; ///< number of recorded values
+	uint64_t min;   ///< smallest recorded value
+	uint64_t max;   ///< largest recorded value
+	double mean;    ///< average value
+	uint64_t p50;   ///< median
+	uint64_t p90;   ///< 90th percentile
+	uint64_t p99;   ///< 99th percentile
+	uint64_t p999;  ///< 99.9th percentile
+
+	LatencySummary() : count(0), min(0), max(0), mean(0),
+		p50(0), p90(0), p99(0), p999(0) {}
+};
+
+/// per-address receive statistics
+struct AddressMetrics {
+	std::string address;    ///< message address
+	uint64_t received;      ///< number of messages received
+	uint64_t handled;       ///< number of messages handled
+	LatencySummary latency; ///< total dispatch time
+};
+
+/// per-object handler statistics
+struct ObjectMetrics {
+	const OscObject *object; ///< the object, for identification only
+	std::string rootAddress; ///< object root address when first seen
+	uint64_t calls;          ///< number of messages passed to the object
+	uint64_t handled;        ///< number of messages handled by the object
+	LatencySummary latency;  ///< handler time
+};
+
+/// a point in time copy of the receive metrics
+struct MetricsSnapshot {
+	double seconds;     ///< time since the metrics were last reset
+	uint64_t received;  ///< number of messages received
+	uint64_t handled;   ///< number of messages handled
+	uint64_t unhandled; ///< number of messages not handled by anything
+	uint64_t ignored;   ///< number of messages dropped by ignoreMessages()
+	uint64_t overflow;  ///< number of messages not tracked per address (table full)
+	LatencySummary latency; ///< total dispatch time for all messages
+	std::vector<AddressMetrics> addresses; ///< per-address stats
+	std::vector<ObjectMetrics> objects;    ///< per-object stats
+
+	/// get the received message rate in messages per second
+	double rate() const {return seconds > 0 ? received / seconds : 0;}
+
+	/// print to std::cout
+	void print() const;
+};
+
+/// \class LatencyHistogram
+/// \brief a lock-free HDR-style latency histogram in nanoseconds
+///
+/// values are counted in log-linear buckets: each power of two range is split
+/// into 8 linear sub buckets, giving ~12.5% precision from 1 ns to ~70 minutes
+class LatencyHistogram {
+
+	public:
+
+		static const unsigned int SUB_BUCKET_BITS = 3;
+		static const unsigned int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+		static const unsigned int MAGNITUDES = 40;
+		static const unsigned int NUM_BUCKETS = MAGNITUDES * SUB_BUCKETS;
+
+		LatencyHistogram();
+
+		/// record a value, safe to call from multiple threads
+		void record(uint64_t ns);
+
+		/// clear all values
+		void reset();
+
+		/// get the current statistics
+		LatencySummary summary() const;
+
+		/// get the bucket index for a given value
+		static unsigned int bucketIndex(uint64_t ns);
+
+		/// get the highest value which maps to a given bucket index
+		static uint64_t bucketValue(unsigned int index);
+
+	private:
+
+		LatencyHistogram(LatencyHistogram const&);              // not copyable
+		LatencyHistogram& operator = (LatencyHistogram const&); // not assignable
+
+		std::atomic<uint64_t> m_buckets[NUM_BUCKETS]; ///< bucket counts
+		std::atomic<uint64_t> m_count; ///< total number of values
+		std::atomic<uint64_t> m_sum;   ///< sum of all values
+		std::atomic<uint64_t> m_min;   ///< smallest value
+		std::atomic<uint64_t> m_max;   ///< largest value
+};
+
+/// \class ReceiveMetrics
+/// \brief lock-free receive counters & latency histograms for an OscReceiver
+///
+/// addresses and objects are tracked in fixed-size tables allocated up front,
+/// so recording never allocates or locks; messages which do not fit are
+/// still counted in the totals and in the overflow count
+class ReceiveMetrics {
+
+	public:
+
+		/// max address length tracked per address, longer addresses overflow
+		static const unsigned int MAX_ADDRESS_LEN = AddressTable::MAX_ADDRESS_LEN;
+
+		/// set the number of addresses & objects to track
+		ReceiveMetrics(unsigned int maxAddresses=128, unsigned int maxObjects=32);
+		virtual ~ReceiveMetrics();
+
+	/// \section Recording
+
+		/// a message was dropped because the receiver is ignoring messages
+		void recordIgnored();
+
+		/// a message was dispatched, ns is the total dispatch time
+		void recordMessage(std::string_view address, bool handled, uint64_t ns);
+
+		/// a message was passed to an object, ns is the handler time
+		void recordObject(const OscObject *object, const std::string &rootAddress,
+		                  bool handled, uint64_t ns);
+
+	/// \section Reading
+
+		/// get a copy of the current metrics, safe to call from any thread
+		MetricsSnapshot snapshot() const;
+
+		/// clear all counters & histograms, tracked addresses & objects are kept
+		void reset();
+
+		/// publish the current metrics as a bundle of messages:
+		///   address/totals h:received h:handled h:unhandled h:ignored h:overflow f:rate
+		///   address/address s:address h:received h:handled h:p50 h:p99 h:max
+		///   address/object s:rootAddress h:calls h:handled h:p50 h:p99 h:max
+		/// latencies are in nanoseconds
+		void publish(OscSender &sender, const std::string &address="/lopack/metrics") const;
+
+	/// \section Util
+
+		/// get a monotonic timestamp in nanoseconds
+		static uint64_t now();
+
+	private:
+
+		ReceiveMetrics(ReceiveMetrics const&);              // not copyable
+		ReceiveMetrics& operator = (ReceiveMetrics const&); // not assignable
+
+		struct AddressSlot {
+			AddressKey key; ///< claimed via findAddressSlot()
+			std::atomic<uint64_t> received;
+			std::atomic<uint64_t> handled;
+			LatencyHistogram latency;
+			AddressSlot() : received(0), handled(0) {
+				key.state.store(SLOT_EMPTY, std::memory_order_relaxed);
+				key.hash.store(0, std::memory_order_relaxed);
+				key.length = 0;
+				key.address[0] = '\0';
+			}
+		};
+
+		struct ObjectSlot {
+			std::atomic<unsigned int> state;
+			std::atomic<const OscObject *> object;
+			char rootAddress[MAX_ADDRESS_LEN];
+			std::atomic<uint64_t> calls;
+			std::atomic<uint64_t> handled;
+			LatencyHistogram latency;
+			ObjectSlot() : state(SLOT_EMPTY), object(NULL), calls(0), handled(0) {
+				rootAddress[0] = '\0';
+			}
+		};
+
+		/// find or claim the slot for a given address, returns NULL if full
+		AddressSlot* addressSlot(std::string_view address);
+
+		/// find or claim the slot for a given object, returns NULL if full
+		ObjectSlot* objectSlot(const OscObject *object, const std::string &rootAddress);
+
+		AddressSlot *m_addresses;    ///< open addressing address table
+		unsigned int m_maxAddresses; ///< address table size
+		ObjectSlot *m_objects;       ///< object table, linear
+		unsigned int m_maxObjects;   ///< object table size
+
+		std::atomic<uint64_t> m_received;  ///< total messages received
+		std::atomic<uint64_t> m_handled;   ///< total messages handled
+		std::atomic<uint64_t> m_ignored;   ///< total messages ignored
+		std::atomic<uint64_t> m_overflow;  ///< messages not tracked per address
+		std::atomic<uint64_t> m_startTime; ///< time of last reset
+		LatencyHistogram m_latency;        ///< total dispatch time
+};
+
+} // namespace
@@ -0,0 +1,143 @@
+/*==============================================================================
+
+	OscMulticast.cpp
+
+	lopack: an oscpack-inspired C++ wrapper for liblo
+
+	Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================*/
+#include "OscMulticast.h"
+
+#include "Log.h"
+#include <algorithm>
+#include <string.h>
+
+#ifdef WIN32
+	#include <winsock2.h>
+	#include <ws2tcpip.h>
+#else
+	#include <arpa/inet.h>
+	#include <netinet/in.h>
+	#include <sys/socket.h>
+#endif
+
+namespace osc {
+
+MulticastGroups::MulticastGroups(const std::string &defaultGroup) : m_defaultGroup(defaultGroup) {}
+
+void MulticastGroups::add(const std::string &prefix, const std::string &group) {
+	for(unsigned int i = 0; i < m_prefixes.size(); ++i) {
+		if(m_prefixes[i].first == prefix) {
+			m_prefixes[i].second = group;
+			return;
+		}
+	}
+	m_prefixes.push_back(std::make_pair(prefix, group));
+}
+
+void MulticastGroups::remove(const std::string &prefix) {
+	for(unsigned int i = 0; i < m_prefixes.size(); ++i) {
+		if(m_prefixes[i].first == prefix) {
+			m_prefixes.erase(m_prefixes.begin() + i);
+			return;
+		}
+	}
+}
+
+const std::string& MulticastGroups::groupFor(std::string_view address) const {
+	const std::string *group = &m_defaultGroup;
+	std::string::size_type longest = 0;
+	for(unsigned int i = 0; i < m_prefixes.size(); ++i) {
+		const std::string &prefix = m_prefixes[i].first;
+		if(prefix.size() >= longest && matches(prefix, address)) {
+			group = &m_prefixes[i].second;
+			longest = prefix.size();
+		}
+	}
+	return *group;
+}
+
+std::vector<std::string> MulticastGroups::groupsFor(std::string_view subtree) const {
+	std::vector<std::string> groups;
+	const std::string &root = groupFor(subtree);
+	if(!root.empty()) {
+		groups.push_back(root);
+	}
+	for(unsigned int i = 0; i < m_prefixes.size(); ++i) {
+		const std::string &group = m_prefixes[i].second;
+		if(matches(subtree, m_prefixes[i].first) &&
+		   std::find(groups.begin(), groups.end(), group) == groups.end()) {
+			groups.push_back(group);
+		}
+	}
+	return groups;
+}
+
+std::vector<std::string> MulticastGroups::getGroups() const {
+	return groupsFor("");
+}
+
+// MEMBERSHIP
+
+bool MulticastGroups::join(int socket, const std::string &group) {
+	struct ip_mreq request;
+	memset(&request, 0, sizeof(request));
+	if(inet_pton(AF_INET, group.c_str(), &request.imr_multiaddr) != 1) {
+		LOG_ERROR << "MulticastGroups: cannot join invalid IPv4 group " << group << std::endl;
+		return false;
+	}
+	request.imr_interface.s_addr = htonl(INADDR_ANY);
+	if(setsockopt(socket, IPPROTO_IP, IP_ADD_MEMBERSHIP, (const char *) &request, sizeof(request)) != 0) {
+		LOG_ERROR << "MulticastGroups: could not join group " << group << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool MulticastGroups::leave(int socket, const std::string &group) {
+	struct ip_mreq request;
+	memset(&request, 0, sizeof(request));
+	if(inet_pton(AF_INET, group.c_str(), &request.imr_multiaddr) != 1) {
+		LOG_ERROR << "MulticastGroups: cannot leave invalid IPv4 group " << group << std::endl;
+		return false;
+	}
+	request.imr_interface.s_addr = htonl(INADDR_ANY);
+	if(setsockopt(socket, IPPROTO_IP, IP_DROP_MEMBERSHIP, (const char *) &request, sizeof(request)) != 0) {
+		LOG_ERROR << "MulticastGroups: could not leave group " << group << std::endl;
+		return false;
+	}
+	return true;
+}
+
+void MulticastGroups::onlyJoinedGroups(int socket) {
+#ifdef IP_MULTICAST_ALL
+	int all = 0;
+	setsockopt(socket, IPPROTO_IP, IP_MULTICAST_ALL, &all, sizeof(all));
+#endif
+}
+
+// PRIVATE
+
+bool MulticastGroups::matches(std::string_view prefix, std::string_view address) {
+	if(prefix.empty() || prefix == "/") {
+		return true;
+	}
+	return address.substr(0, prefix.size()) == prefix &&
+	       (address.size() == prefix.size() || address[prefix.size()] == '/');
+}
+
+} // namespace
@@ -0,0 +1,101 @@
+/*==============================================================================
+
+	OscMulticast.h
+
+	lopack: an oscpack-inspired C++ wrapper for liblo
+
+	Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================*/
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace osc {
+
+/// \class MulticastGroups
+/// \brief maps osc address subtrees to multicast groups
+///
+/// an address is sent to the group of its longest matching prefix, or the
+/// default group if none match; a prefix matches whole address segments, ie.
+/// "/viz" matches "/viz" & "/viz/levels" but not "/vizzy"
+///
+/// share the same map between senders & receivers: OscSender sends each
+/// packet to its group & OscReceiver joins only the groups which can carry
+/// messages for its OscObjects, so unwanted subtrees are filtered by the
+/// network interface & kernel instead of in user space
+///
+///   osc::MulticastGroups groups("239.200.0.1");
+///   groups.add("/viz/levels", "239.200.0.2");
+///   groups.add("/viz/video", "239.200.0.3");
+///
+/// note: IPv4 groups only
+class MulticastGroups {
+
+	public:
+
+		/// set the group for addresses without a matching prefix
+		MulticastGroups(const std::string &defaultGroup="");
+
+		/// route an address prefix to a group, replaces an existing prefix
+		void add(const std::string &prefix, const std::string &group);
+
+		/// remove a prefix
+		void remove(const std::string &prefix);
+
+		/// get the group for an address
+		const std::string& groupFor(std::string_view address) const;
+
+		/// get the groups which can carry messages for an address subtree,
+		/// the group of the subtree root & the groups of any prefixes within it
+		std::vector<std::string> groupsFor(std::string_view subtree) const;
+
+		/// get all groups, including the default
+		std::vector<std::string> getGroups() const;
+
+		/// get/set the default group
+		inline const std::string& getDefaultGroup() const {return m_defaultGroup;}
+		inline void setDefaultGroup(const std::string &group) {m_defaultGroup = group;}
+
+		/// is there a prefix or default group?
+		inline bool empty() const {return m_prefixes.empty() && m_defaultGroup.empty();}
+
+	/// \section Membership
+	///
+	/// join & leave groups on an existing udp socket, all groups share the
+	/// socket's port; returns false & logs on error
+
+		static bool join(int socket, const std::string &group);
+		static bool leave(int socket, const std::string &group);
+
+		/// only receive datagrams for groups this socket joined, on Linux a
+		/// socket otherwise also gets groups joined by other sockets on the
+		/// same port
+		static void onlyJoinedGroups(int socket);
+
+	private:
+
+		/// does the prefix match the address on a segment boundary?
+		static bool matches(std::string_view prefix, std::string_view address);
+
+		std::string m_defaultGroup; ///< group for unmatched addresses
+		std::vector<std::pair<std::string, std::string> > m_prefixes; ///< prefix, group
+};
+
+} // namespace
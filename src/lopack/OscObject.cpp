@@ -23,23 +23,16 @@
 #include "OscObject.h"
 
 #include "Log.h"
-#include <algorithm>
 
 namespace osc {
 
 bool OscObject::processOsc(const ReceivedMessage &message, const MessageSource &source) {
 	// call any attached objects
-	std::vector<OscObject*>::iterator iter;
-	for(iter = m_objects.begin(); iter != m_objects.end();) {
-		if((*iter) != NULL) { // try to process message
-			if((*iter)->processOsc(message, source)) {
-				return true;
-			}
-			iter++; // increment iter
-		}
-		else { // bad object, so erase it
-			iter = m_objects.erase(iter);
-			LOG_WARN << "OscObject: removed NULL object" << std::endl;
+	ObjectList::ReadLock lock;
+	const ObjectList::Objects &objects = m_objects.read();
+	for(unsigned int i = 0; i < objects.size(); ++i) {
+		if(objects[i]->processOsc(message, source)) {
+			return true;
 		}
 	}
 	return processOscMessage(message, source);
@@ -50,7 +43,7 @@ void OscObject::addOscObject(OscObject *object) {
 		LOG_WARN << "OscObject: cannot add NULL object" << std::endl;
 		return;
 	}
-	m_objects.push_back(object);
+	m_objects.add(object);
 }
 
 void OscObject::removeOscObject(OscObject *object) {
@@ -58,12 +51,7 @@ void OscObject::removeOscObject(OscObject *object) {
 		LOG_WARN << "OscObject: cannot remove NULL object" << std::endl;
 		return;
 	}
-	// find object in list and remove it
-	std::vector<OscObject *>::iterator iter;
-	iter = find(m_objects.begin(), m_objects.end(), object);
-	if(iter != m_objects.end()) {
-		m_objects.erase(iter);
-	}
+	m_objects.remove(object);
 }
 
 void OscObject::removeAllOscObjects() {
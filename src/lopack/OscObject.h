@@ -22,7 +22,8 @@
 ==============================================================================*/
 #pragma once
 
-#include <vector>
+#include <utility>
+#include "OscObjectList.h"
 #include "OscTypes.h"
 
 namespace osc {
@@ -35,7 +36,8 @@ class OscObject {
 	
 	public:
 
-		OscObject(std::string rootAddress="") : oscRootAddress(rootAddress) {}
+		OscObject(std::string rootAddress="") : oscRootAddress(std::move(rootAddress)) {}
+		virtual ~OscObject() {}
 
 	/// \section Message Processing
 
@@ -45,7 +47,8 @@ class OscObject {
 
 	/// \section Objects
 
-		/// attach/remove an OscObject to this one
+		/// attach/remove an OscObject to this one,
+		/// safe to call while the receiver is running, see ObjectList
 		void addOscObject(OscObject *object);
 		void removeOscObject(OscObject *object);
 		void removeAllOscObjects();
@@ -53,9 +56,9 @@ class OscObject {
 	/// \section Util
 
 		/// get/set the root address of this object
-		inline void setOscRootAddress(std::string rootAddress) {oscRootAddress = rootAddress;}
+		inline void setOscRootAddress(std::string rootAddress) {oscRootAddress = std::move(rootAddress);}
 		inline std::string& getOscRootAddress() {return oscRootAddress;}
-		inline void prependOscRootAddress(std::string prepend) {oscRootAddress = prepend + oscRootAddress;}
+		inline void prependOscRootAddress(std::string_view prepend) {oscRootAddress.insert(0, prepend);}
 
 	protected:
 
@@ -67,7 +70,7 @@ class OscObject {
 
 	private:
 
-		std::vector<OscObject *> m_objects; ///< currently nested objects
+		ObjectList m_objects; ///< currently nested objects
 };
 
 } // namespace
@@ -0,0 +1,136 @@
+/*==============================================================================
+
+	OscObjectList.cpp
+
+	lopack: an oscpack-inspired C++ wrapper for liblo
+
+	Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================*/
+#include "OscObjectList.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace osc {
+
+// readers count themselves in the counter for the current epoch's parity,
+// shared by all lists so nested objects are covered by any read section
+static std::atomic<unsigned int> s_epoch(0);
+static std::atomic<unsigned int> s_readers[2] = {{0}, {0}};
+static std::mutex s_syncMutex; // serializes epoch flips
+static thread_local unsigned int s_readDepth = 0; // nested read sections
+
+ObjectList::ObjectList() : m_objects(new Objects) {}
+
+ObjectList::ObjectList(const ObjectList &from) : m_objects(NULL) {
+	ReadLock lock;
+	m_objects.store(new Objects(from.read()));
+}
+
+ObjectList& ObjectList::operator=(const ObjectList &from) {
+	if(this == &from) {
+		return *this;
+	}
+	Objects *objects;
+	{
+		ReadLock lock;
+		objects = new Objects(from.read());
+	}
+	std::unique_lock<std::mutex> lock(m_mutex);
+	publish(lock, objects);
+	return *this;
+}
+
+ObjectList::~ObjectList() {
+	for(unsigned int i = 0; i < m_retired.size(); ++i) {
+		delete m_retired[i];
+	}
+	delete m_objects.load();
+}
+
+// CHANGES
+
+void ObjectList::add(OscObject *object) {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	Objects *objects = new Objects(*m_objects.load());
+	objects->push_back(object);
+	publish(lock, objects);
+}
+
+bool ObjectList::remove(OscObject *object) {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	const Objects &current = *m_objects.load();
+	Objects::const_iterator iter = std::find(current.begin(), current.end(), object);
+	if(iter == current.end()) {
+		return false;
+	}
+	Objects *objects = new Objects(current);
+	objects->erase(objects->begin() + (iter - current.begin()));
+	publish(lock, objects);
+	return true;
+}
+
+void ObjectList::clear() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	publish(lock, new Objects);
+}
+
+// READING
+
+ObjectList::ReadLock::ReadLock() {
+	s_readDepth++;
+	m_parity = s_epoch.load() & 1;
+	s_readers[m_parity].fetch_add(1);
+}
+
+ObjectList::ReadLock::~ReadLock() {
+	s_readers[m_parity].fetch_sub(1, std::memory_order_release);
+	s_readDepth--;
+}
+
+// PRIVATE
+
+void ObjectList::publish(std::unique_lock<std::mutex> &lock, Objects *objects) {
+	Objects *old = m_objects.exchange(objects);
+	m_retired.push_back(old);
+	if(s_readDepth > 0) {
+		return; // changed from a handler, waiting would deadlock on ourselves
+	}
+	// take the retired snapshots & wait unlocked, a handler may be blocked
+	// on m_mutex inside the read section being waited for
+	std::vector<Objects *> retired;
+	retired.swap(m_retired);
+	lock.unlock();
+	synchronize();
+	for(unsigned int i = 0; i < retired.size(); ++i) {
+		delete retired[i];
+	}
+}
+
+void ObjectList::synchronize() {
+	std::lock_guard<std::mutex> guard(s_syncMutex);
+	// flip twice: a reader may load the old epoch, stall, & count itself
+	// after the first drain, the second flip waits for it too
+	for(int i = 0; i < 2; ++i) {
+		unsigned int parity = s_epoch.fetch_add(1) & 1;
+		while(s_readers[parity].load() != 0) {
+			std::this_thread::yield();
+		}
+	}
+}
+
+} // namespace
@@ -0,0 +1,111 @@
+/*==============================================================================
+
+	OscObjectList.h
+
+	lopack: an oscpack-inspired C++ wrapper for liblo
+
+	Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================*/
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace osc {
+
+class OscObject;
+
+/// \class ObjectList
+/// \brief a list of OscObjects which can be changed while messages are
+///        being dispatched
+///
+/// read-copy-update: readers iterate an immutable snapshot without locking,
+/// while changes copy the snapshot, atomically swap in the new one, & free
+/// the old one once no reader can still be using it
+///
+/// once add() or remove() return outside of dispatch, no dispatch thread
+/// can still be using a removed object, so it may be deleted
+///
+/// note: a change made from within a message handler, or any other read
+///       section, does not wait for readers, as the caller is one of them;
+///       other shard workers & the caller's own dispatch may still be
+///       using a removed object, so do not free it until a later change or
+///       a synchronize() made from outside dispatch has returned
+class ObjectList {
+
+	public:
+
+		typedef std::vector<OscObject *> Objects;
+
+		ObjectList();
+
+		/// copies take a snapshot of the objects
+		ObjectList(const ObjectList &from);
+		ObjectList& operator=(const ObjectList &from);
+
+		/// no readers may be active
+		virtual ~ObjectList();
+
+	/// \section Changes
+	///
+	/// note: changes are serialized & may wait for active readers
+
+		/// add an object to the end of the list
+		void add(OscObject *object);
+
+		/// remove an object, returns false if it was not found
+		bool remove(OscObject *object);
+
+		/// remove all objects
+		void clear();
+
+	/// \section Reading
+
+		/// marks the calling thread as reading for the lifetime of the lock,
+		/// read sections may be nested
+		class ReadLock {
+			public:
+				ReadLock();
+				~ReadLock();
+			private:
+				ReadLock(ReadLock const&);              // not copyable
+				ReadLock& operator = (ReadLock const&); // not assignable
+				unsigned int m_parity; ///< reader counter used
+		};
+
+		/// get the current snapshot, only valid while holding a ReadLock
+		inline const Objects& read() const {return *m_objects.load();}
+
+		/// wait until all read sections active when called have finished,
+		/// ie. before freeing an object removed from within a handler;
+		/// must not be called from within a read section
+		static void synchronize();
+
+	private:
+
+		/// swap in a new snapshot & reclaim the old one when safe, call with
+		/// m_mutex locked, which is unlocked before waiting for readers so a
+		/// handler changing the list cannot block the wait
+		void publish(std::unique_lock<std::mutex> &lock, Objects *objects);
+
+		std::atomic<Objects *> m_objects; ///< current snapshot
+		std::mutex m_mutex;               ///< serializes changes
+		std::vector<Objects *> m_retired; ///< snapshots waiting to be freed
+};
+
+} // namespace
@@ -24,96 +24,199 @@
 
 #include "Log.h"
 #include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
 #include <sstream>
 
+#ifndef WIN32
+	#include <poll.h>
+	#include <sys/socket.h>
+#endif
+
 namespace osc {
 
 OscReceiver::OscReceiver(std::string rootAddress) :
-	m_oscRootAddress(rootAddress), m_serverThread(NULL), m_isMulticast(false),
-	m_isRunning(false), m_ignoreMessages(false) {}
+	m_oscRootAddress(rootAddress), m_server(NULL), m_isMulticast(false), m_socket(-1), m_kernelTimestamps(false),
+	m_sourceSize(0), m_arrival(0, 0), m_kernelTimestamp(false),
+	m_isRunning(false), m_ignoreMessages(false),
+	m_metricsEnabled(false), m_metrics(NULL),
+	m_sessionsEnabled(false), m_sessions(NULL), m_recorder(NULL), m_state(NULL),
+	m_lanes(NULL), m_dispatching(false), m_shards(NULL),
+	m_reliable(NULL), m_bundleDepth(0),
+	m_bundleHasHeader(false), m_bundleStream(0), m_bundleSequence(0) {}
 
 OscReceiver::OscReceiver(unsigned int port, std::string rootAddress) :
-	m_oscRootAddress(rootAddress), m_serverThread(NULL), m_isMulticast(false),
-	m_isRunning(false), m_ignoreMessages(false) {
+	m_oscRootAddress(rootAddress), m_server(NULL), m_isMulticast(false), m_socket(-1), m_kernelTimestamps(false),
+	m_sourceSize(0), m_arrival(0, 0), m_kernelTimestamp(false),
+	m_isRunning(false), m_ignoreMessages(false),
+	m_metricsEnabled(false), m_metrics(NULL),
+	m_sessionsEnabled(false), m_sessions(NULL), m_recorder(NULL), m_state(NULL),
+	m_lanes(NULL), m_dispatching(false), m_shards(NULL),
+	m_reliable(NULL), m_bundleDepth(0),
+	m_bundleHasHeader(false), m_bundleStream(0), m_bundleSequence(0) {
 	setup(port);
 }
 
 OscReceiver::OscReceiver(std::string group, unsigned int port, std::string rootAddress) :
-	m_oscRootAddress(rootAddress), m_serverThread(NULL), m_isMulticast(false),
-	m_isRunning(false), m_ignoreMessages(false) {
+	m_oscRootAddress(rootAddress), m_server(NULL), m_isMulticast(false), m_socket(-1), m_kernelTimestamps(false),
+	m_sourceSize(0), m_arrival(0, 0), m_kernelTimestamp(false),
+	m_isRunning(false), m_ignoreMessages(false),
+	m_metricsEnabled(false), m_metrics(NULL),
+	m_sessionsEnabled(false), m_sessions(NULL), m_recorder(NULL), m_state(NULL),
+	m_lanes(NULL), m_dispatching(false), m_shards(NULL),
+	m_reliable(NULL), m_bundleDepth(0),
+	m_bundleHasHeader(false), m_bundleStream(0), m_bundleSequence(0) {
 	setupMulticast(group, port);
 }
 
 OscReceiver::~OscReceiver() {
 	clear();
+	m_waiters.cancelAll();
+	if(m_metrics) {
+		delete m_metrics;
+	}
+	if(m_sessions) {
+		delete m_sessions;
+	}
+	if(m_lanes) {
+		delete m_lanes;
+	}
+	if(m_shards) {
+		delete m_shards;
+	}
 }
 
 bool OscReceiver::setup(unsigned int port) {
-	if(m_serverThread) {
+	if(m_server) {
 		LOG_WARN << "OscReceiver: cannot set port while thread is running" << std::endl;
 		return false;
 	}
 	std::stringstream stream;
 	stream << port;
-	m_serverThread = lo_server_thread_new(stream.str().c_str(), &errorCB); 
-	if(!m_serverThread) {
+	m_server = lo_server_new(stream.str().c_str(), &errorCB); 
+	if(!m_server) {
 		LOG_ERROR << "OscReceiver: could not create server" << std::endl;
 		return false;
 	}
-	lo_server_thread_add_method(m_serverThread, NULL, NULL, &messageCB, this);
+	lo_server_add_method(m_server, NULL, NULL, &messageCB, this);
 	m_isMulticast = false;
+	enableKernelTimestamps();
 	return true;
 }
 
 bool OscReceiver::setupMulticast(std::string group, unsigned int port) {
-	if(m_serverThread) {
+	if(m_server) {
 		LOG_WARN << "OscReceiver: cannot set multicast group & port while thread is running" << std::endl;
 		return false;
 	}
 	std::stringstream stream;
 	stream << port;
-	m_serverThread = lo_server_thread_new_multicast(group.c_str(), stream.str().c_str(), &errorCB);
-	if(!m_serverThread) {
+	m_server = lo_server_new_multicast(group.c_str(), stream.str().c_str(), &errorCB);
+	if(!m_server) {
+		LOG_ERROR << "OscReceiver: could not create server" << std::endl;
+		return false;
+	}
+	lo_server_add_method(m_server, NULL, NULL, &messageCB, this);
+	m_isMulticast = true;
+	enableKernelTimestamps();
+	return true;
+}
+
+bool OscReceiver::setupMulticastGroups(const MulticastGroups &groups, unsigned int port) {
+	if(m_server) {
+		LOG_WARN << "OscReceiver: cannot set multicast groups & port while thread is running" << std::endl;
+		return false;
+	}
+	if(groups.empty()) {
+		LOG_WARN << "OscReceiver: cannot set empty multicast groups" << std::endl;
+		return false;
+	}
+	std::unique_lock<std::mutex> lock(m_groupMutex);
+	m_groups = groups;
+	std::vector<std::string> wanted = wantedGroups();
+	std::string first = wanted.empty() ? m_groups.getGroups().front() : wanted.front();
+
+	// liblo joins the first group, the others are joined on the same socket
+	std::stringstream stream;
+	stream << port;
+	m_server = lo_server_new_multicast(first.c_str(), stream.str().c_str(), &errorCB);
+	if(!m_server) {
 		LOG_ERROR << "OscReceiver: could not create server" << std::endl;
+		m_groups = MulticastGroups();
 		return false;
 	}
-	lo_server_thread_add_method(m_serverThread, NULL, NULL, &messageCB, this);
+	lo_server_add_method(m_server, NULL, NULL, &messageCB, this);
 	m_isMulticast = true;
+	enableKernelTimestamps();
+	MulticastGroups::onlyJoinedGroups(m_socket);
+	m_joinedGroups.push_back(first);
+	lock.unlock();
+	updateGroups();
 	return true;
 }
 
+std::vector<std::string> OscReceiver::getJoinedGroups() {
+	std::lock_guard<std::mutex> lock(m_groupMutex);
+	return m_joinedGroups;
+}
+
 void OscReceiver::clear() {
 	stop();
-	if(m_serverThread) {
-		m_serverThread = NULL;
+	if(m_reliable) { // uses the server
+		delete m_reliable;
+		m_reliable = NULL;
+	}
+	if(m_server) {
+		lo_server_free(m_server);
+		m_server = NULL;
 	}
 	m_isMulticast = false;
+	m_socket = -1;
+	std::lock_guard<std::mutex> lock(m_groupMutex);
+	m_groups = MulticastGroups();
+	m_joinedGroups.clear();
 }
 
 // THREAD CONTROL
 
 void OscReceiver::start() {
-	if(!m_serverThread) {
+	if(!m_server) {
 		LOG_ERROR << "OscReceiver: cannot start thread, address not set" << std::endl;
 		return;
 	}
-	lo_server_thread_start(m_serverThread);
+	if(m_isRunning) {
+		return;
+	}
+	if(m_lanes && !m_dispatching.load()) {
+		m_dispatching.store(true);
+		m_laneThread = std::thread(&OscReceiver::runLanes, this);
+	}
 	m_isRunning = true;
+	m_thread = std::thread(&OscReceiver::run, this);
 }
 
 void OscReceiver::stop() {
-	if(!m_serverThread) {
+	if(!m_server || !m_isRunning) {
 		return;
 	}
-	lo_server_thread_stop(m_serverThread);
 	m_isRunning = false;
+	m_thread.join();
+	if(m_dispatching.load()) {
+		m_dispatching.store(false);
+		m_lanes->wake();
+		m_laneThread.join();
+	}
+	if(m_shards) {
+		m_shards->flush();
+	}
 	m_ignoreMessages = false; // reset ignore
 }
 
 // MANUAL POLLING
 
 int OscReceiver::handleMessages(int timeoutMS) {
-	if(!m_serverThread) {
+	if(!m_server) {
 		LOG_ERROR << "OscReceiver: cannot handle messages, address not set" << std::endl;
 		return 0;
 	}
@@ -122,8 +225,30 @@ int OscReceiver::handleMessages(int timeoutMS) {
 		         << "when the thread is already running" << std::endl;
 		return 0;
 	}
-	lo_server server = lo_server_thread_get_server(m_serverThread);
-	return lo_server_recv_noblock(server, timeoutMS);
+	int bytes = receive(timeoutMS);
+	m_waiters.expire();
+	if(m_sessionsEnabled.load()) {
+		m_sessions->expire();
+	}
+	if(m_reliable) {
+		m_reliable->update();
+	}
+	if(m_lanes) {
+		dispatchLanes();
+	}
+	else if(m_shards) {
+		m_shards->flush();
+	}
+	return bytes;
+}
+
+// ARRIVAL TIMES
+
+void OscReceiver::setKernelTimestamps(bool yesno) {
+	m_kernelTimestamps = yesno;
+	if(m_server) {
+		enableKernelTimestamps();
+	}
 }
 
 /// OBJECTS
@@ -133,7 +258,8 @@ void OscReceiver::addOscObject(OscObject *object) {
 		LOG_WARN << "OscReceiver: cannot add NULL object" << std::endl;
 		return;
 	}
-	m_objects.push_back(object);
+	m_objects.add(object);
+	updateGroups();
 }
 
 void OscReceiver::removeOscObject(OscObject *object) {
@@ -141,30 +267,149 @@ void OscReceiver::removeOscObject(OscObject *object) {
 		LOG_WARN << "OscReceiver: cannot remove NULL object" << std::endl;
 		return;
 	}
-	// find object in list and remove it
-	std::vector<OscObject *>::iterator iter;
-	iter = find(m_objects.begin(), m_objects.end(), object);
-	if(iter != m_objects.end()) {
-		m_objects.erase(iter);
-	}
+	m_objects.remove(object);
+	updateGroups();
 }
 
 void OscReceiver::removeAllOscObjects() {
 	m_objects.clear();
+	updateGroups();
+}
+
+// HANDLERS
+
+void OscReceiver::removeHandlers(std::string_view address) {
+	m_handlers.remove(address);
+}
+
+void OscReceiver::removeAllHandlers() {
+	m_handlers.clear();
+}
+
+// METRICS
+
+void OscReceiver::enableMetrics(bool yesno) {
+	if(yesno && !m_metrics) {
+		m_metrics = new ReceiveMetrics;
+	}
+	m_metricsEnabled.store(yesno);
+}
+
+void OscReceiver::publishMetrics(OscSender &sender, const std::string &address) {
+	if(!m_metrics) {
+		LOG_WARN << "OscReceiver: cannot publish metrics, metrics not enabled" << std::endl;
+		return;
+	}
+	m_metrics->publish(sender, address);
+}
+
+// SESSIONS
+
+void OscReceiver::enableSessions(bool yesno, double timeout) {
+	if(yesno) {
+		if(!m_sessions) {
+			m_sessions = new SessionTable(timeout);
+		}
+		else {
+			m_sessions->setTimeout(timeout);
+		}
+	}
+	m_sessionsEnabled.store(yesno);
+}
+
+std::shared_ptr<Session> OscReceiver::getSession(const MessageSource &source) {
+	if(!m_sessions) {
+		return std::shared_ptr<Session>();
+	}
+	return m_sessions->find(source.getKey());
+}
+
+// RECORDING
+
+bool OscReceiver::dispatchMessage(const ReceivedMessage &message, const MessageSource &source) {
+	return processMessage(message, source);
+}
+
+// PRIORITY LANES
+
+bool OscReceiver::setPriorityLanes(unsigned int numLanes, unsigned int capacity) {
+	if(m_isRunning) {
+		LOG_WARN << "OscReceiver: cannot set priority lanes while thread is running" << std::endl;
+		return false;
+	}
+	if(m_shards && numLanes > 0) {
+		LOG_WARN << "OscReceiver: cannot set priority lanes while dispatch shards are enabled" << std::endl;
+		return false;
+	}
+	if(m_lanes) {
+		delete m_lanes;
+		m_lanes = NULL;
+	}
+	if(numLanes > 0) {
+		m_lanes = new PriorityLanes(numLanes, capacity);
+	}
+	return true;
+}
+
+// SHARDED DISPATCH
+
+bool OscReceiver::setDispatchShards(unsigned int numWorkers, unsigned int capacity) {
+	if(m_isRunning) {
+		LOG_WARN << "OscReceiver: cannot set dispatch shards while thread is running" << std::endl;
+		return false;
+	}
+	if(m_lanes && numWorkers > 0) {
+		LOG_WARN << "OscReceiver: cannot set dispatch shards while priority lanes are enabled" << std::endl;
+		return false;
+	}
+	if(m_shards) {
+		delete m_shards;
+		m_shards = NULL;
+	}
+	if(numWorkers > 0) {
+		m_shards = new DispatchShards(numWorkers, capacity, &shardCB, this);
+	}
+	return true;
+}
+
+// RELIABLE DELIVERY
+
+bool OscReceiver::setReliable(bool reliable) {
+	if(m_isRunning) {
+		LOG_WARN << "OscReceiver: cannot set reliable delivery while thread is running" << std::endl;
+		return false;
+	}
+	if(!m_server) {
+		LOG_WARN << "OscReceiver: cannot set reliable delivery, address not set" << std::endl;
+		return false;
+	}
+	if(reliable && !m_reliable) {
+		m_reliable = new ReliableStreams(m_server, &deliverCB, this);
+		lo_server_add_bundle_handlers(m_server, &bundleStartCB, &bundleEndCB, this);
+	}
+	else if(!reliable && m_reliable) {
+		lo_server_add_bundle_handlers(m_server, NULL, NULL, NULL);
+		delete m_reliable;
+		m_reliable = NULL;
+		m_bundleDepth = 0;
+		m_bundleMessages.clear();
+		m_bundleSource.reset();
+	}
+	return true;
 }
 
 // UTIL
 
 const std::string OscReceiver::getHostname() const  {
-	return m_serverThread ? lo_url_get_hostname(lo_server_get_url(lo_server_thread_get_server(m_serverThread))) : "";
+	return m_server ? lo_url_get_hostname(lo_server_get_url(m_server)) : "";
 }
 
 const unsigned int OscReceiver::getPort() const {
-	return m_serverThread ? (unsigned int) lo_server_get_port(lo_server_thread_get_server(m_serverThread)) : 0;
+	return m_server ? (unsigned int) lo_server_get_port(m_server) : 0;
 }
 
 const std::string OscReceiver::getUrl() const {
-	return m_serverThread ? lo_server_get_url(lo_server_thread_get_server(m_serverThread)) : "";
+	return m_server ? lo_server_get_url(m_server) : "";
 }
 
 const bool OscReceiver::isMulticast() const {
@@ -172,7 +417,7 @@ const bool OscReceiver::isMulticast() const {
 }
 
 const void OscReceiver::print() const {
-	if(m_serverThread) {
+	if(m_server) {
 		std::cout << getUrl() << std::endl;
 	}
 }
@@ -180,30 +425,279 @@ const void OscReceiver::print() const {
 // PRIVATE
 
 bool OscReceiver::processMessage(const ReceivedMessage &message, const MessageSource &source) {
+	ReceiveMetrics *metrics = m_metricsEnabled.load() ? m_metrics : NULL;
+
 	// ignore any incoming messages?
 	if(m_ignoreMessages) {
+		if(metrics) {metrics->recordIgnored();}
 		return false;
 	}
+	uint64_t start = metrics ? ReceiveMetrics::now() : 0;
+
+	// awaited messages
+	if(m_waiters.dispatch(message)) {
+		if(metrics) {
+			metrics->recordMessage(message.addressView(), true, ReceiveMetrics::now() - start);
+		}
+		return true;
+	}
+
+	// typed handlers
+	if(m_handlers.dispatch(message)) {
+		if(metrics) {
+			metrics->recordMessage(message.addressView(), true, ReceiveMetrics::now() - start);
+		}
+		return true;
+	}
 		
 	// call any attached objects
-	std::vector<OscObject *>::iterator iter;
-	for(iter = m_objects.begin(); iter != m_objects.end();) {
-		if((*iter) != NULL) { // try to process message
-			if((*iter)->processOsc(message, source))
-				return true;
-			iter++; // increment iter
+	{
+		ObjectList::ReadLock lock;
+		const ObjectList::Objects &objects = m_objects.read();
+		OscObject *matched = NULL;
+		bool onlyMatched = m_shards && m_shards->getKey() == DispatchShards::OBJECT;
+		if(onlyMatched) { // only the object the message was sharded by
+			matched = matchObject(objects, message.addressView());
 		}
-		else { // bad object, so erase it
-			iter = m_objects.erase(iter);
-			LOG_WARN << "OscReceiver: removed NULL object" <<std::endl;
+		for(unsigned int i = 0; i < objects.size(); ++i) {
+			OscObject *object = objects[i];
+			if(onlyMatched && object != matched) {
+				continue;
+			}
+			if(metrics) {
+				uint64_t objectStart = ReceiveMetrics::now();
+				bool handled = object->processOsc(message, source);
+				uint64_t end = ReceiveMetrics::now();
+				metrics->recordObject(object, object->getOscRootAddress(),
+				                      handled, end - objectStart);
+				if(handled) {
+					metrics->recordMessage(message.addressView(), true, end - start);
+					return true;
+				}
+			}
+			else if(object->processOsc(message, source)) {
+				return true;
+			}
 		}
 	}
 
 	// user callback
-	if(process(message, source)) {
-		return true;
+	bool handled = process(message, source);
+	if(metrics) {
+		metrics->recordMessage(message.addressView(), handled, ReceiveMetrics::now() - start);
+	}
+	return handled;
+}
+
+void OscReceiver::run() {
+	while(m_isRunning) {
+		receive(10);
+		m_waiters.expire();
+		if(m_sessionsEnabled.load()) {
+			m_sessions->expire();
+		}
+		if(m_reliable) {
+			m_reliable->update();
+		}
 	}
-	return false;
+}
+
+void OscReceiver::route(const ReceivedMessage &message, const MessageSource &source) {
+	if(m_sessionsEnabled.load()) {
+		m_sessions->touch(source.getKey(), message.getArrivalTime());
+	}
+	StateStore *state = m_state.load();
+	if(state) {
+		state->update(message);
+	}
+	if(m_lanes) {
+		m_lanes->push(message, source);
+	}
+	else if(m_shards) {
+		pushShard(message, source);
+	}
+	else {
+		processMessage(message, source);
+	}
+}
+
+void OscReceiver::dispatchLanes() {
+	PriorityLanes::Item *item;
+	while((item = m_lanes->pop()) != NULL) {
+		processMessage(item->message, item->source);
+		m_lanes->release();
+	}
+}
+
+void OscReceiver::runLanes() {
+	while(m_dispatching.load()) {
+		dispatchLanes();
+		m_lanes->wait(std::chrono::milliseconds(10));
+	}
+	dispatchLanes(); // finish anything queued before the server stopped
+}
+
+void OscReceiver::pushShard(const ReceivedMessage &message, const MessageSource &source) {
+	if(m_shards->getKey() == DispatchShards::OBJECT) {
+		// read locked so the root stays valid
+		ObjectList::ReadLock lock;
+		OscObject *object = matchObject(m_objects.read(), message.addressView());
+		if(object) {
+			m_shards->push(object->getOscRootAddress(), message, source);
+			return;
+		}
+	}
+	m_shards->push(message.addressView(), message, source);
+}
+
+std::vector<std::string> OscReceiver::wantedGroups() {
+	ObjectList::ReadLock lock;
+	const ObjectList::Objects &objects = m_objects.read();
+	if(objects.empty()) {
+		return m_groups.getGroups();
+	}
+	std::vector<std::string> wanted;
+	for(unsigned int i = 0; i < objects.size(); ++i) {
+		std::vector<std::string> groups = m_groups.groupsFor(objects[i]->getOscRootAddress());
+		for(unsigned int j = 0; j < groups.size(); ++j) {
+			if(std::find(wanted.begin(), wanted.end(), groups[j]) == wanted.end()) {
+				wanted.push_back(groups[j]);
+			}
+		}
+	}
+	return wanted;
+}
+
+void OscReceiver::updateGroups() {
+	std::lock_guard<std::mutex> lock(m_groupMutex);
+	if(!m_server || m_groups.empty()) {
+		return;
+	}
+	std::vector<std::string> wanted = wantedGroups();
+	for(unsigned int i = 0; i < m_joinedGroups.size();) {
+		if(std::find(wanted.begin(), wanted.end(), m_joinedGroups[i]) == wanted.end()) {
+			MulticastGroups::leave(m_socket, m_joinedGroups[i]);
+			m_joinedGroups.erase(m_joinedGroups.begin() + i);
+		}
+		else {
+			++i;
+		}
+	}
+	for(unsigned int i = 0; i < wanted.size(); ++i) {
+		if(std::find(m_joinedGroups.begin(), m_joinedGroups.end(), wanted[i]) == m_joinedGroups.end() &&
+		   MulticastGroups::join(m_socket, wanted[i])) {
+			m_joinedGroups.push_back(wanted[i]);
+		}
+	}
+}
+
+void OscReceiver::enableKernelTimestamps() {
+	m_socket = lo_server_get_socket_fd(m_server);
+	if(m_buffer.empty()) {
+		m_buffer.resize(65536); // max udp datagram
+	}
+#ifdef SO_TIMESTAMPNS
+	// the kernel then stamps each datagram & passes the time to recvmsg()
+	int enable = m_kernelTimestamps ? 1 : 0;
+	setsockopt(m_socket, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable));
+#endif
+}
+
+int OscReceiver::receive(int timeoutMS) {
+#ifdef WIN32
+	// no recvmsg(), let liblo receive the datagram & resolve its source
+	return lo_server_recv_noblock(m_server, timeoutMS);
+#else
+	// future time tagged bundles wait in liblo's event queue, so wake up in
+	// time for the next one
+	if(lo_server_events_pending(m_server)) {
+		int delayMS = (int) ceil(lo_server_next_event_delay(m_server) * 1000);
+		timeoutMS = std::min(timeoutMS, std::max(delayMS, 0));
+	}
+	int bytes = 0;
+	struct pollfd fd;
+	fd.fd = m_socket;
+	fd.events = POLLIN;
+	fd.revents = 0;
+	if(poll(&fd, 1, timeoutMS) > 0) {
+		bytes = receiveDatagram();
+	}
+	dispatchEvents();
+	return bytes;
+#endif
+}
+
+#ifndef WIN32
+int OscReceiver::receiveDatagram() {
+	// read the datagram with its binary source address & kernel timestamp,
+	// so the source needs no lookup or string work per message
+	struct iovec iov;
+	iov.iov_base = &m_buffer[0];
+	iov.iov_len = m_buffer.size();
+	union {
+		char buffer[CMSG_SPACE(sizeof(struct timespec))];
+		struct cmsghdr align;
+	} control;
+	struct msghdr header;
+	memset(&header, 0, sizeof(header));
+	header.msg_name = m_sourceAddress;
+	header.msg_namelen = sizeof(m_sourceAddress);
+	header.msg_iov = &iov;
+	header.msg_iovlen = 1;
+	header.msg_control = control.buffer;
+	header.msg_controllen = sizeof(control.buffer);
+	int bytes = recvmsg(m_socket, &header, MSG_DONTWAIT);
+	if(bytes <= 0) {
+		return 0;
+	}
+	m_sourceSize = header.msg_namelen;
+	m_kernelTimestamp = false;
+#ifdef SCM_TIMESTAMPNS
+	for(struct cmsghdr *c = CMSG_FIRSTHDR(&header); c; c = CMSG_NXTHDR(&header, c)) {
+		if(c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPNS) {
+			struct timespec ts;
+			memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+			m_arrival.setUnixTime(ts.tv_sec, ts.tv_nsec);
+			m_kernelTimestamp = true;
+		}
+	}
+#endif
+	if(!m_kernelTimestamp) {
+		m_arrival.now();
+	}
+	OscRecorder *recorder = m_recorder.load();
+	if(recorder) { // before liblo, which byte swaps the datagram in place
+		recorder->record(&m_buffer[0], bytes, m_arrival, m_kernelTimestamp,
+		                 (const struct sockaddr *) m_sourceAddress, m_sourceSize);
+	}
+	lo_server_dispatch_data(m_server, &m_buffer[0], bytes);
+	m_sourceSize = 0;
+	return bytes;
+}
+#endif
+
+void OscReceiver::dispatchEvents() {
+	// only lo_server_recv*() dispatches the queue, which it does before
+	// reading the socket once an event is due within liblo's 10 ms window;
+	// bounded in case liblo reads a datagram instead
+	for(unsigned int i = 0; i < 64 && lo_server_events_pending(m_server) &&
+	    lo_server_next_event_delay(m_server) < 0.01; ++i) {
+		lo_server_recv_noblock(m_server, 0);
+	}
+}
+
+OscObject* OscReceiver::matchObject(const ObjectList::Objects &objects, std::string_view address) {
+	OscObject *matched = NULL;
+	std::string_view::size_type longest = 0;
+	for(unsigned int i = 0; i < objects.size(); ++i) {
+		const std::string &root = objects[i]->getOscRootAddress();
+		if(!root.empty() && root.size() > longest && address.substr(0, root.size()) == root &&
+		   (address.size() == root.size() || address[root.size()] == '/')) {
+			matched = objects[i];
+			longest = root.size();
+		}
+	}
+	return matched;
 }
 
 // STATIC CALLBACKS
@@ -219,8 +713,73 @@ void OscReceiver::errorCB(int num, const char *msg, const char *where) {
 int OscReceiver::messageCB(const char *path, const char *types, lo_arg **argv,
                            int argc, lo_message msg, void *user_data) {
 	OscReceiver *receiver = (OscReceiver *)user_data;
-	return receiver->processMessage(ReceivedMessage(path, msg),
-	                                MessageSource(lo_message_get_source(msg)));
+	bool received = receiver->m_sourceSize > 0; // by receive(), not liblo?
+	if(!received) {
+		receiver->m_arrival.now();
+		receiver->m_kernelTimestamp = false;
+	}
+	ReceivedMessage message(path, msg, receiver->m_arrival, receiver->m_kernelTimestamp);
+	MessageSource source = received ?
+		MessageSource((const struct sockaddr *) receiver->m_sourceAddress,
+		              receiver->m_sourceSize, receiver->m_socket) :
+		MessageSource(lo_message_get_source(msg), receiver->m_socket);
+	if(receiver->m_reliable && receiver->m_bundleDepth > 0) {
+		// hold the bundle's messages until its end, the header may be anywhere
+		if(strcmp(path, LOPACK_RELIABLE_HEADER) == 0 && argc == 2 &&
+		   types[0] == LO_INT32 && types[1] == LO_INT32) {
+			receiver->m_bundleHasHeader = true;
+			receiver->m_bundleStream = argv[0]->i;
+			receiver->m_bundleSequence = (uint32_t) argv[1]->i;
+		}
+		else {
+			receiver->m_bundleMessages.push_back(message);
+		}
+		if(!receiver->m_bundleSource) {
+			receiver->m_bundleSource.emplace(source);
+		}
+		return 0;
+	}
+	receiver->route(message, source);
+	return 0;
+}
+
+void OscReceiver::shardCB(const ReceivedMessage &message,
+                          const MessageSource &source, void *userData) {
+	((OscReceiver *)userData)->processMessage(message, source);
+}
+
+int OscReceiver::bundleStartCB(lo_timetag time, void *user_data) {
+	OscReceiver *receiver = (OscReceiver *)user_data;
+	receiver->m_bundleDepth++;
+	return 0;
+}
+
+int OscReceiver::bundleEndCB(void *user_data) {
+	OscReceiver *receiver = (OscReceiver *)user_data;
+	if(receiver->m_bundleDepth == 0 || --receiver->m_bundleDepth > 0) {
+		return 0;
+	}
+	if(receiver->m_bundleSource) {
+		if(receiver->m_bundleHasHeader) {
+			receiver->m_reliable->receive(receiver->m_bundleStream, receiver->m_bundleSequence,
+			                              receiver->m_bundleMessages, *receiver->m_bundleSource);
+		}
+		else {
+			deliverCB(receiver->m_bundleMessages, *receiver->m_bundleSource, receiver);
+		}
+	}
+	receiver->m_bundleMessages.clear();
+	receiver->m_bundleSource.reset();
+	receiver->m_bundleHasHeader = false;
+	return 0;
+}
+
+void OscReceiver::deliverCB(const std::vector<ReceivedMessage> &messages,
+                            const MessageSource &source, void *userData) {
+	OscReceiver *receiver = (OscReceiver *)userData;
+	for(unsigned int i = 0; i < messages.size(); ++i) {
+		receiver->route(messages[i], source);
+	}
 }
 
 } // namespace
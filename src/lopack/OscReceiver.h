@@ -22,7 +22,20 @@
 ==============================================================================*/
 #pragma once
 
+#include "OscAwait.h"
+#include "OscHandlers.h"
 #include "OscObject.h"
+#include "OscLanes.h"
+#include "OscMetrics.h"
+#include "OscMulticast.h"
+#include "OscRecorder.h"
+#include "OscReliable.h"
+#include "OscSessions.h"
+#include "OscShards.h"
+#include "OscState.h"
+#include <mutex>
+#include <optional>
+#include <thread>
 
 namespace osc {
 
@@ -66,6 +79,20 @@ class OscReceiver {
 		/// see http://tldp.org/HOWTO/Multicast-HOWTO-2.html
 		/// returns true on success
 		bool setupMulticast(std::string group, unsigned int port);
+
+		/// setup the udp socket for the groups of a multicast group map using
+		/// the given port, see MulticastGroups; only the groups which can
+		/// carry messages for the added OscObjects' root addresses are joined
+		/// & the groups are rejoined as objects are added & removed, all
+		/// groups are joined while there are no objects
+		///
+		/// note: handlers, awaited messages, & process() only receive
+		///       messages sent to the joined groups
+		/// returns true on success
+		bool setupMulticastGroups(const MulticastGroups &groups, unsigned int port);
+
+		/// get the currently joined multicast groups
+		std::vector<std::string> getJoinedGroups();
 	
 		/// stop thread & release socket
 		void clear();
@@ -89,24 +116,209 @@ class OscReceiver {
 		/// while the thread is running
 		int handleMessages(int timeoutMS=0);
 
+	/// \section Arrival Times
+
+		/// enable/disable kernel receive timestamps for message arrival times,
+		/// disabled by default; when enabled, each datagram's arrival time is
+		/// the kernel's receive timestamp (Linux), which comes with the
+		/// datagram so it costs no extra syscall, otherwise it is the time
+		/// the receiver read it; all messages in a bundle share the time
+		void setKernelTimestamps(bool yesno);
+
+		/// are kernel receive timestamps enabled?
+		inline bool kernelTimestampsEnabled() {return m_kernelTimestamps;}
+
 	/// \section Objects
 
-		/// add an OscObject to send received messages to
+		/// add an OscObject to send received messages to,
+		/// objects can be added & removed while the thread is running
 		void addOscObject(OscObject *object);
 
-		/// remove an OscObject
+		/// remove an OscObject, it will not be called once this returns
+		///
+		/// note: when removed from within a handler, other dispatch threads
+		///       & the current dispatch may still be using the object, see
+		///       ObjectList, call ObjectList::synchronize() from outside
+		///       dispatch before freeing it
 		void removeOscObject(OscObject *object);
 	
 		/// remove all OscObjects
 		void removeAllOscObjects();
 
+	/// \section Handlers
+	///
+	/// typed handlers are called before any OscObjects or process(), see
+	/// HandlerRegistry; add handlers before calling start()
+
+		/// call a function for messages to an address with the given argument
+		/// types, ie. on<int32_t, float>("/synth/note", [](int32_t n, float v) {...})
+		/// the function returns void (handled) or bool (true if handled)
+		template <class... Args, class Function>
+		void on(std::string_view address, Function &&function) {
+			m_handlers.add<Args...>(address, std::forward<Function>(function));
+		}
+
+		/// remove all handlers for an address
+		void removeHandlers(std::string_view address);
+
+		/// remove all handlers
+		void removeAllHandlers();
+
+	/// \section Awaiting Messages
+	///
+	/// coroutines can wait for a message without a thread or callback, each
+	/// incoming message resumes the oldest coroutine waiting for its address
+	/// before any handlers or objects see it; coroutines are resumed on the
+	/// receive thread (or the lane or shard thread dispatching), or within
+	/// handleMessages() when polling, & timeouts are checked every 10 ms
+	///
+	///   osc::Task query(osc::OscSender &sender, osc::OscReceiver &receiver) {
+	///       sender << osc::BeginMessage("/query") << osc::EndMessage();
+	///       sender.send();
+	///       auto reply = co_await receiver.next("/reply/x", 0.5);
+	///       if(reply) {...} else {... timed out ...}
+	///   }
+	///
+	/// waits still pending when the receiver is destroyed resume with no
+	/// message & must not wait again; requires C++20
+
+#ifdef LOPACK_HAVE_COROUTINES
+		/// wait for the next message to an address, timeout in seconds,
+		/// < 0 waits forever; the result is empty on timeout
+		inline MessageAwaitable next(std::string_view address, double timeout=-1) {
+			return MessageAwaitable(m_waiters, address, timeout);
+		}
+#endif
+
+		/// get the pending waits, also usable without coroutines
+		inline MessageWaiters& getWaiters() {return m_waiters;}
+
+	/// \section Metrics
+
+		/// enable/disable collecting receive metrics, disabled by default
+		///
+		/// counts messages & times handlers per address and per attached
+		/// OscObject, the first enable allocates the metrics tables
+		void enableMetrics(bool yesno);
+
+		/// are receive metrics being collected?
+		inline bool metricsEnabled() {return m_metricsEnabled.load();}
+
+		/// get the receive metrics, returns NULL if metrics were never enabled
+		inline ReceiveMetrics* getMetrics() {return m_metrics;}
+
+		/// publish the current metrics as OSC messages, see ReceiveMetrics::publish()
+		void publishMetrics(OscSender &sender, const std::string &address="/lopack/metrics");
+
+	/// \section Sessions
+
+		/// enable/disable tracking per source sessions, disabled by default
+		///
+		/// counts messages & the last arrival time per source socket address,
+		/// sessions idle longer than timeout seconds are expired by the receive
+		/// loop, 0 keeps them until removed; the first enable allocates the
+		/// session table
+		void enableSessions(bool yesno, double timeout=0);
+
+		/// are sessions being tracked?
+		inline bool sessionsEnabled() {return m_sessionsEnabled.load();}
+
+		/// get the session table, returns NULL if sessions were never enabled
+		inline SessionTable* getSessions() {return m_sessions;}
+
+		/// get the session for a message source,
+		/// returns NULL if not found or sessions were never enabled
+		std::shared_ptr<Session> getSession(const MessageSource &source);
+
+	/// \section Recording
+
+		/// set a recorder to capture all received datagrams as they are
+		/// read, before dispatch, set to NULL to stop recording
+		///
+		/// note: the recorder is not owned by the receiver
+		inline void setRecorder(OscRecorder *recorder) {m_recorder.store(recorder);}
+
+		/// get the current recorder, NULL if not recording
+		inline OscRecorder* getRecorder() {return m_recorder.load();}
+
+	/// \section State
+
+		/// set a state store to keep the latest values of its registered
+		/// addresses, updated by the receive thread before dispatch, set to
+		/// NULL to stop updating
+		///
+		/// note: the store is not owned by the receiver
+		inline void setStateStore(StateStore *store) {m_state.store(store);}
+
+		/// get the current state store, NULL if none
+		inline StateStore* getStateStore() {return m_state.load();}
+
+		/// dispatch a message to the attached objects & process() callback as
+		/// if it had been received, used to replay captured messages
+		/// returns true if the message was handled
+		bool dispatchMessage(const ReceivedMessage &message, const MessageSource &source);
+
+	/// \section Priority Lanes
+	///
+	/// with priority lanes, the receive thread queues each message in a lane
+	/// by address prefix & a separate dispatch thread calls the objects &
+	/// process() callback in priority order, see PriorityLanes
+	///
+	/// when polling with handleMessages(), queued messages are dispatched
+	/// after receiving; lanes are disabled by default
+
+		/// use numLanes priority lanes with capacity messages each, 0 disables,
+		/// set up the lanes with getPriorityLanes() before calling start()
+		/// returns false if the thread is running
+		bool setPriorityLanes(unsigned int numLanes, unsigned int capacity=1024);
+
+		/// get the priority lanes, NULL if disabled
+		inline PriorityLanes* getPriorityLanes() {return m_lanes;}
+
+	/// \section Sharded Dispatch
+	///
+	/// with dispatch shards, the receive thread queues each message to one of
+	/// a pool of worker threads by hashing its address or OscObject root,
+	/// messages with the same key keep their order while different keys are
+	/// dispatched in parallel, see DispatchShards
+	///
+	/// handlers, objects, & process() may then be called from several
+	/// threads at once; when sharding by OscObject root, each top-level
+	/// object is only passed the messages under its root & so is called from
+	/// one worker while the roots do not change; when polling with
+	/// handleMessages(), it waits for the workers to dispatch what was
+	/// received; cannot be used with priority lanes, disabled by default
+
+		/// use numWorkers dispatch threads with capacity messages each,
+		/// 0 disables, returns false if the thread is running or priority
+		/// lanes are enabled
+		bool setDispatchShards(unsigned int numWorkers, unsigned int capacity=1024);
+
+		/// get the dispatch shards, NULL if disabled
+		inline DispatchShards* getDispatchShards() {return m_shards;}
+
+	/// \section Reliable Delivery
+	///
+	/// receives packets from an OscSender with reliable delivery enabled, see
+	/// OscSender::setReliable(); packets are dispatched in order per stream,
+	/// packets after a gap are held while the missing ones are NACKed, other
+	/// messages are dispatched as usual; disabled by default
+
+		/// enable/disable reliable delivery, call after setup(),
+		/// returns false if the thread is running or the address is not set
+		bool setReliable(bool reliable);
+
+		/// get the reliable streams, ie. to set the NACK timing & get the
+		/// receive counters, NULL if disabled
+		inline ReliableStreams* getReliableStreams() {return m_reliable;}
+
 	/// \section Util
 
 		/// is the thread running?
-		bool isListening() {return true;}
+		inline bool isListening() {return m_isRunning.load();}
 
 		/// get/set the root address of this object
-		inline void setOscRootAddress(std::string rootAddress)	{m_oscRootAddress = rootAddress;}
+		inline void setOscRootAddress(std::string rootAddress)	{m_oscRootAddress = std::move(rootAddress);}
 		inline std::string &getOscRootAddress()	{return m_oscRootAddress;}
 
 		/// ignore incoming messages while keeping port open (thread running)?
@@ -140,18 +352,101 @@ class OscReceiver {
 		/// virtual callback from oscpack
 		bool processMessage(const ReceivedMessage &message, const MessageSource &source);
 
+		/// receive thread loop
+		void run();
+
+		/// read & dispatch one datagram, waiting up to timeoutMS or until
+		/// the next scheduled bundle is due, returns the number of bytes
+		/// received
+		int receive(int timeoutMS);
+
+		/// read & dispatch a waiting datagram, returns the number of bytes
+		int receiveDatagram();
+
+		/// dispatch scheduled bundles which are due from liblo's event queue
+		void dispatchEvents();
+
+		/// record & queue or dispatch a received message
+		void route(const ReceivedMessage &message, const MessageSource &source);
+
+		/// dispatch all queued lane messages
+		void dispatchLanes();
+
+		/// lane dispatch thread loop
+		void runLanes();
+
+		/// queue a message to the shard for its key
+		void pushShard(const ReceivedMessage &message, const MessageSource &source);
+
+		/// get the object with the longest root address matching an address
+		/// on a segment boundary, NULL if none
+		static OscObject* matchObject(const ObjectList::Objects &objects, std::string_view address);
+
+		/// get the multicast groups for the objects' root addresses
+		std::vector<std::string> wantedGroups();
+
+		/// join & leave multicast groups to match the objects
+		void updateGroups();
+
+		/// get the server socket & turn kernel receive timestamps on or off
+		void enableKernelTimestamps();
+
 		// static liblo callbacks
 		static void errorCB(int num, const char *msg, const char *where);
 		static int messageCB(const char *path, const char *types, lo_arg **argv,
 		                     int argc, lo_message msg, void *user_data);
+		static void shardCB(const ReceivedMessage &message,
+		                    const MessageSource &source, void *userData);
+		static int bundleStartCB(lo_timetag time, void *user_data);
+		static int bundleEndCB(void *user_data);
+		static void deliverCB(const std::vector<ReceivedMessage> &messages,
+		                      const MessageSource &source, void *userData);
 		
-		lo_server_thread m_serverThread; ///< liblo server thread handle
+		lo_server m_server; ///< liblo server handle
 		bool m_isMulticast; ///< is the server listening to a multicast group?
+		int m_socket; ///< server socket file descriptor
+		bool m_kernelTimestamps; ///< read kernel receive timestamps?
 
-		bool m_isRunning; ///< should the thread be running?
+		std::vector<char> m_buffer; ///< datagram receive buffer
+		unsigned char m_sourceAddress[128]; ///< socket address of the datagram being dispatched
+		unsigned int m_sourceSize; ///< source address size, 0 if liblo received the datagram
+		TimeTag m_arrival;         ///< arrival time of the datagram being dispatched
+		bool m_kernelTimestamp;    ///< is the arrival time from the kernel?
+
+		MulticastGroups m_groups; ///< multicast groups by address prefix, empty if unused
+		std::vector<std::string> m_joinedGroups; ///< currently joined groups
+		std::mutex m_groupMutex; ///< guards the joined groups
+
+		std::thread m_thread; ///< receive thread
+		std::atomic<bool> m_isRunning; ///< should the thread be running?
 		bool m_ignoreMessages; ///< ignore incoming messages?
 
-		std::vector<OscObject *> m_objects; ///< osc objects to send messages to
+		MessageWaiters m_waiters;   ///< awaited messages
+		HandlerRegistry m_handlers; ///< typed handlers by address
+		ObjectList m_objects; ///< osc objects to send messages to
+
+		std::atomic<bool> m_metricsEnabled; ///< collect metrics?
+		ReceiveMetrics *m_metrics; ///< receive metrics, allocated on first enable
+
+		std::atomic<bool> m_sessionsEnabled; ///< track sessions?
+		SessionTable *m_sessions; ///< per source sessions, allocated on first enable
+
+		std::atomic<OscRecorder *> m_recorder; ///< message recorder, if any
+		std::atomic<StateStore *> m_state;     ///< latest value store, if any
+
+		PriorityLanes *m_lanes;         ///< priority lanes, NULL if disabled
+		std::thread m_laneThread;       ///< lane dispatch thread
+		std::atomic<bool> m_dispatching; ///< keep the dispatch thread running?
+
+		DispatchShards *m_shards; ///< dispatch shards, NULL if disabled
+
+		ReliableStreams *m_reliable; ///< reliable delivery, NULL if disabled
+		unsigned int m_bundleDepth;  ///< nesting depth of the bundle being received
+		std::vector<ReceivedMessage> m_bundleMessages; ///< messages of the bundle being received
+		std::optional<MessageSource> m_bundleSource;   ///< source of the bundle being received
+		bool m_bundleHasHeader;   ///< does the bundle have a reliable header?
+		int32_t m_bundleStream;    ///< reliable header stream id
+		uint32_t m_bundleSequence; ///< reliable header sequence number
 };
 
 } // namespace
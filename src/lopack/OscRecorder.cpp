@@ -0,0 +1,473 @@
+/*==============================================================================
+
+	OscRecorder.cpp
+
+	lopack: an oscpack-inspired C++ wrapper for liblo
+
+	Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================*/
+#include "OscRecorder.h"
+
+#include "OscReceiver.h"
+#include "OscSender.h"
+#include "Log.h"
+#include <algorithm>
+#include <thread>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef WIN32
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace osc {
+
+static const char CAPTURE_MAGIC[8] = {'L','P','C','A','P','T','U','R'};
+static const uint32_t CAPTURE_VERSION = 2;
+static const uint32_t CAPTURE_FLAG_KERNEL_TIMESTAMP = 0x01;
+static const size_t CAPTURE_GROW_SIZE = 1024 * 1024; // min file growth
+
+/// capture file header
+struct CaptureHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t headerSize;
+	uint64_t created;
+	uint64_t reserved;
+};
+
+/// capture record header, followed by source address & datagram
+struct CaptureRecord {
+	uint32_t size;
+	uint32_t datagramSize;
+	uint64_t arrival;
+	uint16_t sourceSize;
+	uint8_t flags;
+	uint8_t reserved1;
+	uint32_t reserved2;
+};
+
+// pack/unpack a timetag into a uint64
+static uint64_t packTimeTag(const TimeTag &tag) {
+	return ((uint64_t) tag.sec << 32) | tag.frac;
+}
+static TimeTag unpackTimeTag(uint64_t packed) {
+	return TimeTag((uint32_t)(packed >> 32), (uint32_t)(packed & 0xFFFFFFFF));
+}
+
+// round up to the record alignment
+static size_t align8(size_t size) {
+	return (size + 7) & ~((size_t) 7);
+}
+
+// read a big endian OSC int
+static uint32_t readUInt32(const char *data) {
+	const unsigned char *bytes = (const unsigned char *) data;
+	return ((uint32_t) bytes[0] << 24) | ((uint32_t) bytes[1] << 16) |
+	       ((uint32_t) bytes[2] << 8) | (uint32_t) bytes[3];
+}
+
+// RECORDER
+
+OscRecorder::OscRecorder() :
+	m_file(-1), m_map(NULL), m_mapSize(0), m_offset(0), m_numRecords(0) {}
+
+OscRecorder::~OscRecorder() {
+	close();
+}
+
+bool OscRecorder::open(const std::string &path) {
+	close();
+#ifdef WIN32
+	LOG_ERROR << "OscRecorder: capture files are not supported on Windows" << std::endl;
+	return false;
+#else
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_file = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if(m_file < 0) {
+		LOG_ERROR << "OscRecorder: could not open " << path << ": "
+		          << strerror(errno) << std::endl;
+		return false;
+	}
+	if(!reserve(sizeof(CaptureHeader))) {
+		::close(m_file);
+		m_file = -1;
+		return false;
+	}
+	CaptureHeader *header = (CaptureHeader *) m_map;
+	memcpy(header->magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+	header->version = CAPTURE_VERSION;
+	header->headerSize = sizeof(CaptureHeader);
+	header->created = packTimeTag(TimeTag());
+	header->reserved = 0;
+	m_offset = sizeof(CaptureHeader);
+	m_numRecords = 0;
+	return true;
+#endif
+}
+
+void OscRecorder::close() {
+#ifndef WIN32
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if(m_file < 0) {
+		return;
+	}
+	unmap();
+	if(ftruncate(m_file, m_offset) < 0) { // trim unused growth
+		LOG_WARN << "OscRecorder: could not trim capture file" << std::endl;
+	}
+	::close(m_file);
+	m_file = -1;
+	m_offset = 0;
+#endif
+}
+
+bool OscRecorder::isOpen() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_file >= 0;
+}
+
+bool OscRecorder::record(const char *data, size_t size, const TimeTag &arrival,
+                         bool kernelTimestamp, const struct sockaddr *source,
+                         unsigned int sourceSize) {
+	if(!source) {
+		sourceSize = 0;
+	}
+	size_t recordSize = align8(sizeof(CaptureRecord) + align8(sourceSize) + size);
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if(m_file < 0) {
+		return false;
+	}
+	if(!reserve(recordSize)) {
+		return false;
+	}
+
+	// write directly into the mapping, unused bytes are already zeroed,
+	// the datagram is 8 byte aligned after the source address
+	char *dest = m_map + m_offset;
+	CaptureRecord *record = (CaptureRecord *) dest;
+	record->datagramSize = size;
+	record->arrival = packTimeTag(arrival);
+	record->sourceSize = sourceSize;
+	record->flags = kernelTimestamp ? CAPTURE_FLAG_KERNEL_TIMESTAMP : 0;
+	dest += sizeof(CaptureRecord);
+	if(sourceSize > 0) {
+		memcpy(dest, source, sourceSize);
+		dest += align8(sourceSize);
+	}
+	memcpy(dest, data, size);
+
+	// set size last, a zero size marks the end of the file
+	record->size = recordSize;
+	m_offset += recordSize;
+	m_numRecords++;
+	return true;
+}
+
+unsigned long OscRecorder::getNumRecords() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_numRecords;
+}
+
+unsigned long OscRecorder::getSize() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_offset;
+}
+
+// PRIVATE
+
+bool OscRecorder::reserve(size_t size) {
+#ifdef WIN32
+	return false;
+#else
+	if(m_offset + size <= m_mapSize) {
+		return true;
+	}
+
+	// grow by at least half the current size to keep remapping rare
+	size_t newSize = m_offset + size;
+	newSize = std::max(newSize, m_mapSize + std::max(m_mapSize / 2, CAPTURE_GROW_SIZE));
+	unmap();
+	if(ftruncate(m_file, newSize) < 0) { // new space is zero filled
+		LOG_ERROR << "OscRecorder: could not grow capture file: "
+		          << strerror(errno) << std::endl;
+		return false;
+	}
+	void *map = mmap(NULL, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_file, 0);
+	if(map == MAP_FAILED) {
+		LOG_ERROR << "OscRecorder: could not map capture file: "
+		          << strerror(errno) << std::endl;
+		return false;
+	}
+	m_map = (char *) map;
+	m_mapSize = newSize;
+	return true;
+#endif
+}
+
+void OscRecorder::unmap() {
+#ifndef WIN32
+	if(m_map) {
+		munmap(m_map, m_mapSize);
+		m_map = NULL;
+		m_mapSize = 0;
+	}
+#endif
+}
+
+// REPLAYER RECORD
+
+OscReplayer::Record::Record() :
+	arrival(0, 0), timetag(0, 1), kernelTimestamp(false), source(NULL),
+	sourceSize(0), message(NULL) {}
+
+OscReplayer::Record::~Record() {
+	if(message) {
+		lo_message_free(message);
+	}
+}
+
+// REPLAYER
+
+OscReplayer::OscReplayer() :
+	m_file(-1), m_map(NULL), m_mapSize(0), m_offset(0),
+	m_datagram(NULL), m_element(0),
+	m_started(false), m_firstArrival(0, 0) {}
+
+OscReplayer::~OscReplayer() {
+	close();
+}
+
+bool OscReplayer::open(const std::string &path) {
+	close();
+#ifdef WIN32
+	LOG_ERROR << "OscReplayer: capture files are not supported on Windows" << std::endl;
+	return false;
+#else
+	m_file = ::open(path.c_str(), O_RDONLY);
+	if(m_file < 0) {
+		LOG_ERROR << "OscReplayer: could not open " << path << ": "
+		          << strerror(errno) << std::endl;
+		return false;
+	}
+	struct stat info;
+	if(fstat(m_file, &info) < 0 || (size_t) info.st_size < sizeof(CaptureHeader)) {
+		LOG_ERROR << "OscReplayer: " << path << " is not a capture file" << std::endl;
+		close();
+		return false;
+	}
+	void *map = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, m_file, 0);
+	if(map == MAP_FAILED) {
+		LOG_ERROR << "OscReplayer: could not map " << path << ": "
+		          << strerror(errno) << std::endl;
+		close();
+		return false;
+	}
+	m_map = (char *) map;
+	m_mapSize = info.st_size;
+	const CaptureHeader *header = (const CaptureHeader *) m_map;
+	if(memcmp(header->magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0 ||
+	   header->version != CAPTURE_VERSION ||
+	   header->headerSize < sizeof(CaptureHeader) ||
+	   header->headerSize > m_mapSize) {
+		LOG_ERROR << "OscReplayer: " << path << " is not a version "
+		          << CAPTURE_VERSION << " capture file" << std::endl;
+		close();
+		return false;
+	}
+	rewind();
+	return true;
+#endif
+}
+
+void OscReplayer::close() {
+#ifndef WIN32
+	if(m_map) {
+		munmap(m_map, m_mapSize);
+		m_map = NULL;
+		m_mapSize = 0;
+	}
+	if(m_file >= 0) {
+		::close(m_file);
+		m_file = -1;
+	}
+#endif
+	m_offset = 0;
+	m_datagram = NULL;
+	m_elements.clear();
+	m_element = 0;
+}
+
+bool OscReplayer::isOpen() {
+	return m_map != NULL;
+}
+
+bool OscReplayer::next(Record &record) {
+	while(m_map) {
+		// read the next datagram once its messages are used up
+		if(m_element >= m_elements.size()) {
+			if(m_offset + sizeof(CaptureRecord) > m_mapSize) {
+				return false;
+			}
+			const CaptureRecord *header = (const CaptureRecord *)(m_map + m_offset);
+			if(header->size == 0 || m_offset + header->size > m_mapSize ||
+			   sizeof(CaptureRecord) + align8(header->sourceSize) +
+			   header->datagramSize > header->size) {
+				return false; // end of file or truncated record
+			}
+			m_datagram = m_map + m_offset;
+			m_offset += header->size;
+			m_elements.clear();
+			m_element = 0;
+			readPacket(m_datagram + sizeof(CaptureRecord) + align8(header->sourceSize),
+			           header->datagramSize, TimeTag(0, 1));
+			continue;
+		}
+		const Element &element = m_elements[m_element++];
+
+		// the message is deserialised from a copy as liblo converts in place
+		int result = 0;
+		std::string buffer(element.data, element.size);
+		lo_message message = lo_message_deserialise(&buffer[0], buffer.size(), &result);
+		if(!message) {
+			LOG_WARN << "OscReplayer: skipping bad message, liblo error "
+			         << result << std::endl;
+			continue;
+		}
+		if(record.message) {
+			lo_message_free(record.message);
+		}
+		lo_message_incref(message); // deserialised messages start unreferenced
+		const CaptureRecord *header = (const CaptureRecord *) m_datagram;
+		record.message = message;
+		record.address = buffer.c_str(); // address is the first string
+		record.source = header->sourceSize > 0 ?
+			(const struct sockaddr *)(m_datagram + sizeof(CaptureRecord)) : NULL;
+		record.sourceSize = header->sourceSize;
+		record.arrival = unpackTimeTag(header->arrival);
+		record.timetag = element.timetag;
+		record.kernelTimestamp = header->flags & CAPTURE_FLAG_KERNEL_TIMESTAMP;
+		return true;
+	}
+	return false;
+}
+
+void OscReplayer::rewind() {
+	m_offset = m_map ? ((const CaptureHeader *) m_map)->headerSize : 0;
+	m_datagram = NULL;
+	m_elements.clear();
+	m_element = 0;
+	m_started = false;
+}
+
+// REPLAY
+
+unsigned long OscReplayer::replay(OscSender &sender, double speed) {
+	unsigned long count = 0;
+	Record record;
+	rewind();
+	while(next(record)) {
+		wait(record, speed);
+		ReceivedMessage message(record.address, record.message);
+		if(!record.timetag.isImmediate()) {
+			sender << BeginBundle(record.timetag);
+		}
+		sender.beginMessage(record.address);
+		sender.addArguments(message);
+		sender.endMessage();
+		if(!record.timetag.isImmediate()) {
+			sender << EndBundle();
+		}
+		sender.send();
+		count++;
+	}
+	return count;
+}
+
+unsigned long OscReplayer::replay(OscReceiver &receiver, double speed) {
+	unsigned long count = 0;
+	Record record;
+	rewind();
+	while(next(record)) {
+		wait(record, speed);
+		if(record.address == LOPACK_RELIABLE_HEADER) {
+			continue; // the receiver's reliable layer would have consumed it
+		}
+		ReceivedMessage message(record.address, record.message);
+		if(record.source) {
+			receiver.dispatchMessage(message, MessageSource(record.source, record.sourceSize));
+		}
+		else { // unknown source
+			lo_address address = lo_address_new("localhost", "0");
+			receiver.dispatchMessage(message, MessageSource(address));
+			lo_address_free(address);
+		}
+		count++;
+	}
+	return count;
+}
+
+// PRIVATE
+
+void OscReplayer::readPacket(const char *data, size_t size, const TimeTag &timetag) {
+	// bundle: "#bundle", time tag, & elements each prefixed by their size
+	static const char BUNDLE_TAG[8] = {'#','b','u','n','d','l','e','\0'};
+	if(size < sizeof(BUNDLE_TAG) || memcmp(data, BUNDLE_TAG, sizeof(BUNDLE_TAG)) != 0) {
+		Element element = {data, size, timetag};
+		m_elements.push_back(element);
+		return;
+	}
+	if(size < 16) {
+		return; // truncated
+	}
+	TimeTag bundleTag(readUInt32(data + 8), readUInt32(data + 12));
+	size_t offset = 16;
+	while(offset + 4 <= size) {
+		size_t elementSize = readUInt32(data + offset);
+		offset += 4;
+		if(elementSize > size - offset) {
+			break; // truncated
+		}
+		readPacket(data + offset, elementSize, bundleTag);
+		offset += elementSize;
+	}
+}
+
+void OscReplayer::wait(const Record &record, double speed) {
+	if(!m_started) {
+		m_started = true;
+		m_firstArrival = record.arrival;
+		m_startTime = std::chrono::steady_clock::now();
+		return;
+	}
+	if(speed <= 0) {
+		return; // as fast as possible
+	}
+	double offset = (record.arrival - m_firstArrival) / speed;
+	if(offset <= 0) {
+		return;
+	}
+	std::this_thread::sleep_until(m_startTime +
+		std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+			std::chrono::duration<double>(offset)));
+}
+
+} // namespace
@@ -0,0 +1,203 @@
+/*==============================================================================
+
+	OscRecorder.h
+
+	lopack: an oscpack-inspired C++ wrapper for liblo
+
+	Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================*/
+#pragma once
+
+#include "OscTypes.h"
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace osc {
+
+class OscSender;
+class OscReceiver;
+
+/// \section Capture File Format
+///
+/// a capture file is a 32 byte header followed by 8 byte aligned records,
+/// all integers are in host byte order:
+///
+///   header: char magic[8] "LPCAPTUR", uint32 version, uint32 header size,
+///           uint64 creation time (OSC time tag), uint64 reserved
+///
+///   record: uint32 record size (including padding, 0 = end of file),
+///           uint32 datagram size, uint64 arrival time (OSC time tag),
+///           uint16 source size, uint8 flags, uint8 reserved,
+///           uint32 reserved, source socket address, datagram
+///
+/// the datagram is the OSC message or bundle exactly as received, the
+/// source is its binary socket address, ie. sockaddr_in or sockaddr_in6,
+/// & time tags are packed as (sec << 32) | frac
+
+/// \class OscRecorder
+/// \brief appends received messages to a memory-mapped capture file
+///
+/// attach to an OscReceiver with OscReceiver::setRecorder(), each datagram
+/// is recorded with its arrival time & source as it is read, before liblo
+/// parses it, so recording does no serialising or string work
+///
+/// note: datagrams are recorded as they arrived on the wire, so bundles are
+///       kept whole & reliable delivery headers & retransmits are included;
+///       datagrams read by liblo, ie. on Windows, are not recorded
+class OscRecorder {
+
+	public:
+
+		OscRecorder();
+		virtual ~OscRecorder();
+
+		/// open a capture file for writing, replaces any existing file
+		/// returns true on success
+		bool open(const std::string &path);
+
+		/// finish writing & close the capture file
+		void close();
+
+		/// is a capture file open?
+		bool isOpen();
+
+		/// append a datagram to the capture file, safe to call from any thread
+		/// source is the sender's socket address, NULL if unknown
+		/// returns true on success
+		bool record(const char *data, size_t size, const TimeTag &arrival,
+		            bool kernelTimestamp, const struct sockaddr *source=NULL,
+		            unsigned int sourceSize=0);
+
+		/// get the number of records written
+		unsigned long getNumRecords();
+
+		/// get the number of bytes written, including the header
+		unsigned long getSize();
+
+	private:
+
+		OscRecorder(OscRecorder const&);              // not copyable
+		OscRecorder& operator = (OscRecorder const&); // not assignable
+
+		/// grow the file & mapping to fit at least size more bytes
+		bool reserve(size_t size);
+
+		/// unmap the file
+		void unmap();
+
+		std::mutex m_mutex; ///< serializes writes & remapping
+		int m_file;         ///< file descriptor
+		char *m_map;        ///< mapped file memory
+		size_t m_mapSize;   ///< mapped & file size
+		size_t m_offset;    ///< write position
+		unsigned long m_numRecords; ///< number of records written
+};
+
+/// \class OscReplayer
+/// \brief replays messages from a capture file written by OscRecorder
+///
+/// messages can be sent to another host with an OscSender or dispatched
+/// directly to an OscReceiver's objects & process() callback; bundles are
+/// read as the messages they contain, each with its bundle's time tag
+class OscReplayer {
+
+	public:
+
+		/// a single captured message
+		struct Record {
+			TimeTag arrival;      ///< arrival time when captured
+			TimeTag timetag;      ///< bundle time tag, immediate if none
+			bool kernelTimestamp; ///< is the arrival time from the kernel?
+			const struct sockaddr *source; ///< source socket address, NULL if
+			                               ///< unknown, valid while open
+			unsigned int sourceSize;       ///< source socket address size
+			std::string address;  ///< message address
+			lo_message message;   ///< the message, owned by the Record
+			Record();
+			~Record();
+			private:
+				Record(Record const&);              // not copyable
+				Record& operator = (Record const&); // not assignable
+		};
+
+		OscReplayer();
+		virtual ~OscReplayer();
+
+		/// open a capture file for reading
+		/// returns true on success
+		bool open(const std::string &path);
+
+		/// close the capture file
+		void close();
+
+		/// is a capture file open?
+		bool isOpen();
+
+		/// read the next record, returns false at the end of the file
+		bool next(Record &record);
+
+		/// go back to the first record
+		void rewind();
+
+	/// \section Replay
+	///
+	/// speed scales the original timing between messages: 1 is the original
+	/// speed, 2 is twice as fast, 0.5 is half speed, & 0 is as fast as possible
+	///
+	/// both return the number of messages replayed from the beginning of the file
+
+		/// send each message to the sender's destination, messages recorded
+		/// with a bundle time tag are sent in a bundle with the same time tag
+		unsigned long replay(OscSender &sender, double speed=1.0);
+
+		/// dispatch each message directly to the receiver's objects & callback
+		unsigned long replay(OscReceiver &receiver, double speed=1.0);
+
+	private:
+
+		OscReplayer(OscReplayer const&);              // not copyable
+		OscReplayer& operator = (OscReplayer const&); // not assignable
+
+		/// wait until a record is due
+		void wait(const Record &record, double speed);
+
+		/// a message within the current datagram
+		struct Element {
+			const char *data; ///< message data in the mapping
+			size_t size;      ///< message size
+			TimeTag timetag;  ///< enclosing bundle time tag, immediate if none
+		};
+
+		/// add the messages in a message or bundle to m_elements
+		void readPacket(const char *data, size_t size, const TimeTag &timetag);
+
+		int m_file;        ///< file descriptor
+		char *m_map;       ///< mapped file memory
+		size_t m_mapSize;  ///< mapped & file size
+		size_t m_offset;   ///< read position
+
+		const char *m_datagram;          ///< current datagram record, if any
+		std::vector<Element> m_elements; ///< messages in the current datagram
+		unsigned int m_element;          ///< next element to read
+
+		bool m_started;        ///< has the first record been timed?
+		TimeTag m_firstArrival; ///< arrival time of the first record
+		std::chrono::steady_clock::time_point m_startTime; ///< replay start time
+};
+
+} // namespace
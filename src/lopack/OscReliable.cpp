@@ -0,0 +1,194 @@
+/*==============================================================================
+
+	OscReliable.cpp
+
+	lopack: an oscpack-inspired C++ wrapper for liblo
+
+	Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================*/
+#include "OscReliable.h"
+
+#include "Log.h"
+#include <algorithm>
+
+namespace osc {
+
+// NACKs list at most this many missing packets, later ones are NACKed once
+// the first are filled
+static const unsigned int s_maxNackEntries = 64;
+
+// wrapping sequence distance, > 0 if a is after b
+static inline int32_t seqDiff(uint32_t a, uint32_t b) {
+	return (int32_t) (a - b);
+}
+
+ReliableStreams::ReliableStreams(lo_server server, DeliverCB callback, void *userData) :
+	m_server(server), m_callback(callback), m_userData(userData),
+	m_nackInterval(0.02), m_maxNacks(3), m_maxHeld(1024), m_streamTimeout(10) {}
+
+ReliableStreams::~ReliableStreams() {
+	Streams::iterator iter;
+	for(iter = m_streams.begin(); iter != m_streams.end(); ++iter) {
+		delete iter->second;
+	}
+}
+
+void ReliableStreams::setNacks(double interval, unsigned int maxNacks, unsigned int maxHeld) {
+	m_nackInterval = std::max(interval, 0.0);
+	m_maxNacks = maxNacks;
+	m_maxHeld = std::max(maxHeld, 1U);
+}
+
+void ReliableStreams::setStreamTimeout(double timeout) {
+	m_streamTimeout = std::max(timeout, 0.0);
+}
+
+void ReliableStreams::receive(int32_t stream, uint32_t sequence,
+                              const std::vector<ReceivedMessage> &messages,
+                              const MessageSource &source) {
+	{
+		std::lock_guard<std::mutex> lock(m_statsMutex);
+		m_stats.received++;
+	}
+	StreamKey key;
+	key.source = source.getKey();
+	key.id = stream;
+	Streams::iterator iter = m_streams.find(key);
+	if(iter == m_streams.end()) { // new stream, start from this packet
+		iter = m_streams.insert(std::make_pair(key, new Stream(stream, sequence, source))).first;
+	}
+	Stream &s = *iter->second;
+	s.lastReceived = Clock::now();
+
+	int32_t diff = seqDiff(sequence, s.expected);
+	if(sequence == 0 && diff < -(int32_t) m_maxHeld) { // the sender restarted
+		s.expected = 0;
+		s.held.clear();
+		s.nacks = 0;
+		diff = 0;
+	}
+	if(diff < 0 || s.held.count(sequence)) {
+		std::lock_guard<std::mutex> lock(m_statsMutex);
+		m_stats.duplicates++;
+		return;
+	}
+	if(diff == 0) {
+		s.expected++;
+		{
+			std::lock_guard<std::mutex> lock(m_statsMutex);
+			m_stats.delivered++;
+		}
+		m_callback(messages, source, m_userData);
+		deliverHeld(s);
+		return;
+	}
+
+	// ahead of a gap, hold & NACK right away if this opens a new gap
+	bool opens = s.held.empty() || seqDiff(sequence, s.held.rbegin()->first) > 1;
+	s.held.emplace(sequence, Held{messages, source});
+	if(s.held.size() > m_maxHeld) {
+		skipGap(s);
+		return;
+	}
+	if(opens) {
+		s.nacks = 0;
+		sendNack(s);
+	}
+}
+
+void ReliableStreams::update() {
+	Clock::time_point now = Clock::now();
+	Streams::iterator iter = m_streams.begin();
+	while(iter != m_streams.end()) {
+		Stream &s = *iter->second;
+		if(s.held.empty() && m_streamTimeout > 0 &&
+		   std::chrono::duration<double>(now - s.lastReceived).count() > m_streamTimeout) {
+			delete iter->second;
+			iter = m_streams.erase(iter);
+			continue;
+		}
+		++iter;
+		if(s.held.empty() ||
+		   std::chrono::duration<double>(now - s.lastNack).count() < m_nackInterval) {
+			continue;
+		}
+		if(s.nacks < m_maxNacks) {
+			sendNack(s);
+		}
+		else {
+			skipGap(s);
+		}
+	}
+}
+
+ReliableStats ReliableStreams::getStats() {
+	std::lock_guard<std::mutex> lock(m_statsMutex);
+	return m_stats;
+}
+
+// PRIVATE
+
+void ReliableStreams::deliverHeld(Stream &stream) {
+	std::map<uint32_t, Held, SequenceLess>::iterator iter;
+	while(!stream.held.empty() && (iter = stream.held.find(stream.expected)) != stream.held.end()) {
+		stream.expected++;
+		{
+			std::lock_guard<std::mutex> lock(m_statsMutex);
+			m_stats.delivered++;
+			m_stats.reordered++;
+		}
+		m_callback(iter->second.messages, iter->second.source, m_userData);
+		stream.held.erase(iter);
+	}
+	if(stream.held.empty()) {
+		stream.nacks = 0;
+	}
+}
+
+void ReliableStreams::sendNack(Stream &stream) {
+	lo_message nack = lo_message_new();
+	lo_message_add_int32(nack, stream.id);
+	unsigned int count = 0;
+	uint32_t last = stream.held.rbegin()->first;
+	for(uint32_t seq = stream.expected; seqDiff(last, seq) > 0 && count < s_maxNackEntries; ++seq) {
+		if(!stream.held.count(seq)) {
+			lo_message_add_int32(nack, (int32_t) seq);
+			count++;
+		}
+	}
+	if(lo_send_message_from(stream.source.getAddress(), m_server, LOPACK_RELIABLE_NACK, nack) < 0) {
+		LOG_WARN << "ReliableStreams: could not send NACK to " << stream.source.getUrl() << std::endl;
+	}
+	lo_message_free(nack);
+	stream.nacks++;
+	stream.lastNack = Clock::now();
+	std::lock_guard<std::mutex> lock(m_statsMutex);
+	m_stats.nacksSent++;
+}
+
+void ReliableStreams::skipGap(Stream &stream) {
+	uint32_t next = stream.held.begin()->first;
+	{
+		std::lock_guard<std::mutex> lock(m_statsMutex);
+		m_stats.lost += (uint32_t) seqDiff(next, stream.expected);
+	}
+	stream.expected = next;
+	stream.nacks = 0;
+	deliverHeld(stream);
+}
+
+} // namespace
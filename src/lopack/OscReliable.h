@@ -0,0 +1,191 @@
+/*==============================================================================
+
+	OscReliable.h
+
+	lopack: an oscpack-inspired C++ wrapper for liblo
+
+	Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================*/
+#pragma once
+
+#include "OscTypes.h"
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace osc {
+
+/// \section Reliable Delivery Format
+///
+/// a reliable packet is a bundle containing the packet's messages & a header
+/// message to LOPACK_RELIABLE_HEADER with the int32 stream id & int32
+/// sequence number; the stream id is a hash of the stream name, sequence
+/// numbers count up from 0 per stream & wrap as unsigned 32 bit values
+///
+/// the receiver requests missing packets with a message to
+/// LOPACK_RELIABLE_NACK sent back to the packet's source, with the int32
+/// stream id followed by the int32 sequence number of each missing packet
+
+#define LOPACK_RELIABLE_HEADER "/lopack/rel"
+#define LOPACK_RELIABLE_NACK   "/lopack/rel/nack"
+
+/// reliable delivery counters, the sender counts the first group & the
+/// receiver the second
+struct ReliableStats {
+
+	// sender
+	uint64_t sent;          ///< packets sent with a sequence header
+	uint64_t nacksReceived; ///< NACK messages received
+	uint64_t retransmits;   ///< packets resent from the retransmit buffer
+	uint64_t expired;       ///< requested packets no longer buffered
+
+	// receiver
+	uint64_t received;   ///< packets received, including retransmits
+	uint64_t delivered;  ///< packets dispatched in order
+	uint64_t reordered;  ///< packets held until a gap was filled
+	uint64_t duplicates; ///< packets received more than once & dropped
+	uint64_t nacksSent;  ///< NACK messages sent
+	uint64_t lost;       ///< packets given up on after the NACKs ran out
+
+	ReliableStats() : sent(0), nacksReceived(0), retransmits(0), expired(0),
+		received(0), delivered(0), reordered(0), duplicates(0), nacksSent(0), lost(0) {}
+};
+
+/// \class ReliableStreams
+/// \brief receive side sequencing for reliable delivery
+///
+/// tracks the next expected sequence number per source & stream, packets
+/// ahead of a gap are held, the gap is NACKed immediately & again every
+/// NACK interval until filled or the NACKs run out, after which it is
+/// skipped & counted as lost; streams are independent so a gap only holds
+/// back its own stream
+///
+/// streams are keyed by the source's binary socket address & the stream
+/// id, & are forgotten once idle longer than the stream timeout, so a
+/// sender which restarts later starts a new stream; a packet numbered 0
+/// far behind a stream also restarts it
+///
+/// note: not thread safe, call from the receive thread only except getStats()
+class ReliableStreams {
+
+	public:
+
+		/// called with each in order packet's messages
+		typedef void (*DeliverCB)(const std::vector<ReceivedMessage> &messages,
+		                          const MessageSource &source, void *userData);
+
+		/// server is used to send NACKs from the receive socket
+		ReliableStreams(lo_server server, DeliverCB callback, void *userData);
+		virtual ~ReliableStreams();
+
+		/// set the seconds between NACKs for a gap, ~ the round trip time,
+		/// the NACKs per gap before giving up, & the max held packets per
+		/// stream, defaults 0.02, 3, & 1024
+		void setNacks(double interval, unsigned int maxNacks, unsigned int maxHeld=1024);
+
+		/// set the seconds a stream can be idle before it is forgotten,
+		/// default 10, 0 keeps streams until destroyed
+		void setStreamTimeout(double timeout);
+
+		/// handle a received packet, delivers it & any held packets it frees
+		void receive(int32_t stream, uint32_t sequence,
+		             const std::vector<ReceivedMessage> &messages, const MessageSource &source);
+
+		/// resend due NACKs, skip gaps which ran out of NACKs, & forget idle
+		/// streams
+		void update();
+
+		/// get the number of tracked streams
+		inline unsigned int getNumStreams() const {return m_streams.size();}
+
+		/// get the receive counters, safe to call from any thread
+		ReliableStats getStats();
+
+	private:
+
+		ReliableStreams(ReliableStreams const&);              // not copyable
+		ReliableStreams& operator = (ReliableStreams const&); // not assignable
+
+		typedef std::chrono::steady_clock Clock;
+
+		/// a packet held until the gap before it is filled
+		struct Held {
+			std::vector<ReceivedMessage> messages;
+			MessageSource source;
+		};
+
+		/// orders wrapping sequence numbers, held packets are always within
+		/// half the sequence space of each other
+		struct SequenceLess {
+			bool operator()(uint32_t a, uint32_t b) const {return (int32_t) (a - b) < 0;}
+		};
+
+		/// per source & stream state
+		struct Stream {
+			int32_t id;        ///< stream id
+			uint32_t expected; ///< next sequence number to deliver
+			std::map<uint32_t, Held, SequenceLess> held; ///< packets ahead of the gap
+			unsigned int nacks;    ///< NACKs sent for the current gap
+			Clock::time_point lastNack;     ///< when the last NACK was sent
+			Clock::time_point lastReceived; ///< when the last packet arrived
+			MessageSource source;  ///< where to send NACKs
+			Stream(int32_t id_, uint32_t expected_, const MessageSource &source_) :
+				id(id_), expected(expected_), nacks(0), source(source_) {}
+		};
+
+		/// source socket address & stream id
+		struct StreamKey {
+			SourceKey source;
+			int32_t id;
+			bool operator==(const StreamKey &key) const {
+				return id == key.id && source == key.source;
+			}
+			struct Hash {
+				size_t operator()(const StreamKey &key) const {
+					return hashBytes(&key.id, sizeof(key.id), SourceKey::Hash()(key.source));
+				}
+			};
+		};
+
+		/// streams by source & stream id
+		typedef std::unordered_map<StreamKey, Stream*, StreamKey::Hash> Streams;
+
+		/// deliver held packets which are now in order
+		void deliverHeld(Stream &stream);
+
+		/// NACK every missing sequence number before the last held packet
+		void sendNack(Stream &stream);
+
+		/// skip the current gap, counting the missing packets as lost
+		void skipGap(Stream &stream);
+
+		lo_server m_server;     ///< server to send NACKs from
+		DeliverCB m_callback;   ///< delivery callback
+		void *m_userData;       ///< callback user data
+		double m_nackInterval;  ///< seconds between NACKs
+		unsigned int m_maxNacks; ///< NACKs per gap
+		unsigned int m_maxHeld;  ///< held packets per stream
+		double m_streamTimeout;  ///< seconds before an idle stream is forgotten
+
+		Streams m_streams; ///< by source & stream id
+		std::mutex m_statsMutex; ///< guards m_stats
+		ReliableStats m_stats;   ///< receive counters
+};
+
+} // namespace
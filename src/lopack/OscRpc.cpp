@@ -0,0 +1,235 @@
+/*==============================================================================
+
+	OscRpc.cpp
+
+	lopack: an oscpack-inspired C++ wrapper for liblo
+
+	Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================*/
+#include "OscRpc.h"
+
+#include "OscReceiver.h"
+#include "OscSender.h"
+#include "Log.h"
+#include <memory>
+#include <vector>
+
+namespace osc {
+
+// RPC CLIENT
+
+RpcClient::RpcClient(OscSender &sender, OscReceiver &receiver, const std::string &replyAddress) :
+	OscObject(replyAddress), m_sender(sender), m_receiver(receiver),
+	m_nextId(1), m_sweeping(true) {
+	m_sweeper = std::thread(&RpcClient::sweep, this);
+	m_receiver.addOscObject(this);
+}
+
+RpcClient::~RpcClient() {
+	m_receiver.removeOscObject(this); // not called for replies once removed
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_sweeping = false;
+		m_condition.notify_one();
+	}
+	m_sweeper.join();
+	cancelAll();
+}
+
+// REQUESTS
+
+int32_t RpcClient::beginRequest(std::string_view address) {
+	int32_t id;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		id = m_nextId++;
+		if(m_nextId <= 0) { // wrapped, ids are positive
+			m_nextId = 1;
+		}
+	}
+	m_sender.beginMessage(address);
+	m_sender.addInt32(id);
+	m_sender.addInt32((int32_t) m_receiver.getPort());
+	return id;
+}
+
+bool RpcClient::send(int32_t id, double timeout, Callback callback) {
+	{
+		// register first, the reply may arrive before send() returns
+		std::lock_guard<std::mutex> lock(m_mutex);
+		Pending &pending = m_pending[id];
+		pending.callback = std::move(callback);
+		Clock::time_point deadline = Clock::now() +
+			std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(timeout));
+		pending.timer = m_timers.insert(std::make_pair(deadline, id));
+		if(pending.timer == m_timers.begin()) {
+			m_condition.notify_one(); // new earliest deadline
+		}
+	}
+	if(!m_sender.send()) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::unordered_map<int32_t, Pending>::iterator iter = m_pending.find(id);
+		if(iter != m_pending.end()) {
+			m_timers.erase(iter->second.timer);
+			m_pending.erase(iter);
+		}
+		return false;
+	}
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stats.sent++;
+	return true;
+}
+
+std::future<std::optional<ReceivedMessage> > RpcClient::send(int32_t id, double timeout) {
+	std::shared_ptr<std::promise<std::optional<ReceivedMessage> > > promise =
+		std::make_shared<std::promise<std::optional<ReceivedMessage> > >();
+	std::future<std::optional<ReceivedMessage> > future = promise->get_future();
+	if(!send(id, timeout, [promise](const ReceivedMessage *reply) {
+		// the future is read on another thread, so give it its own clone
+		promise->set_value(reply ? std::optional<ReceivedMessage>(reply->clone()) : std::nullopt);
+	})) {
+		promise->set_value(std::nullopt);
+	}
+	return future;
+}
+
+bool RpcClient::cancel(int32_t id) {
+	return complete(id, NULL);
+}
+
+void RpcClient::cancelAll() {
+	std::vector<int32_t> ids;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::unordered_map<int32_t, Pending>::iterator iter;
+		for(iter = m_pending.begin(); iter != m_pending.end(); ++iter) {
+			ids.push_back(iter->first);
+		}
+	}
+	for(unsigned int i = 0; i < ids.size(); ++i) {
+		complete(ids[i], NULL);
+	}
+}
+
+// UTIL
+
+RpcStats RpcClient::getStats() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	RpcStats stats = m_stats;
+	stats.pending = m_pending.size();
+	return stats;
+}
+
+// PROTECTED
+
+bool RpcClient::processOscMessage(const ReceivedMessage &message, const MessageSource &source) {
+	if(message.addressView() != oscRootAddress || message.numArgs() < 1 || !message.isInt32(0)) {
+		return false;
+	}
+	if(!complete(message.asInt32(0), &message)) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stats.late++;
+	}
+	return true;
+}
+
+// PRIVATE
+
+bool RpcClient::complete(int32_t id, const ReceivedMessage *reply) {
+	Callback callback;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::unordered_map<int32_t, Pending>::iterator iter = m_pending.find(id);
+		if(iter == m_pending.end()) {
+			return false;
+		}
+		callback = std::move(iter->second.callback);
+		m_timers.erase(iter->second.timer);
+		m_pending.erase(iter);
+		if(reply) {
+			m_stats.replied++;
+		}
+		else {
+			m_stats.timedOut++;
+		}
+	}
+	if(callback) {
+		callback(reply);
+	}
+	return true;
+}
+
+void RpcClient::sweep() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while(m_sweeping) {
+		if(m_timers.empty()) {
+			m_condition.wait(lock);
+			continue;
+		}
+		Clock::time_point deadline = m_timers.begin()->first;
+		if(Clock::now() < deadline) {
+			m_condition.wait_until(lock, deadline);
+			continue;
+		}
+		int32_t id = m_timers.begin()->second;
+		lock.unlock();
+		complete(id, NULL);
+		lock.lock();
+	}
+}
+
+// RPC RESPONDER
+
+RpcResponder::RpcResponder(const std::string &replyAddress) :
+	m_replyAddress(replyAddress), m_sender(new OscSender()), m_port(0) {}
+
+RpcResponder::~RpcResponder() {
+	delete m_sender;
+}
+
+bool RpcResponder::isRequest(const ReceivedMessage &message) {
+	return message.numArgs() >= FIRST_ARG && message.isInt32(0) && message.isInt32(1);
+}
+
+int32_t RpcResponder::getId(const ReceivedMessage &request) {
+	return request.asInt32(0);
+}
+
+OscSender& RpcResponder::beginReply(const ReceivedMessage &request, const MessageSource &source) {
+	int32_t id = request.asInt32(0);
+	int32_t port = request.asInt32(1);
+	std::string host = source.getHostname();
+	if(port != m_port || host != m_host) { // retarget, the pool caches the peer
+		if(!m_sender->setupPooled(host, port)) {
+			m_sender->setup(host, port);
+		}
+		m_host = host;
+		m_port = port;
+	}
+	m_sender->beginMessage(m_replyAddress);
+	m_sender->addInt32(id);
+	return *m_sender;
+}
+
+void RpcResponder::clear() {
+	delete m_sender;
+	m_sender = new OscSender();
+	m_host.clear();
+	m_port = 0;
+}
+
+} // namespace
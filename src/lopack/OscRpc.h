@@ -0,0 +1,208 @@
+/*==============================================================================
+
+	OscRpc.h
+
+	lopack: an oscpack-inspired C++ wrapper for liblo
+
+	Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================*/
+#pragma once
+
+#include "OscObject.h"
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+
+namespace osc {
+
+class OscSender;
+class OscReceiver;
+
+/// \section RPC Message Format
+///
+/// a request is a message to any address whose first two arguments are
+/// int32 correlation id & int32 reply port, followed by the request
+/// parameters; the responder replies to the requester's host & reply port
+/// with a message to the reply address, default "/lopack/rpc/reply", whose
+/// first argument is the int32 correlation id followed by the results
+
+/// default rpc reply address
+#define LOPACK_RPC_REPLY_ADDRESS "/lopack/rpc/reply"
+
+/// rpc client counters
+struct RpcStats {
+	uint64_t sent;     ///< requests sent
+	uint64_t replied;  ///< requests which received a reply
+	uint64_t timedOut; ///< requests which timed out or were cancelled
+	uint64_t late;     ///< replies with an unknown id, ie. after a timeout
+	unsigned int pending; ///< requests currently waiting for a reply
+
+	RpcStats() : sent(0), replied(0), timedOut(0), late(0), pending(0) {}
+};
+
+/// \class RpcClient
+/// \brief sends requests & routes replies by correlation id
+///
+/// any number of requests may be in flight, replies are matched in a hash
+/// table by id & a single timer thread sweeps timed out requests
+///
+///   int32_t id = rpc.beginRequest("/synth/query");
+///   sender << "voices" << osc::EndMessage();
+///   rpc.send(id, 0.5, [](const osc::ReceivedMessage *reply) {...});
+///
+/// reply callbacks are called from the receiver's dispatch thread, timeouts
+/// from the client's timer thread; the reply is NULL on timeout
+class RpcClient : protected OscObject {
+
+	public:
+
+		/// reply or timeout callback, reply is NULL on timeout or cancel
+		typedef std::function<void(const ReceivedMessage *reply)> Callback;
+
+		/// send requests with sender & receive replies with receiver, adds
+		/// itself to the receiver as an OscObject
+		RpcClient(OscSender &sender, OscReceiver &receiver,
+		          const std::string &replyAddress=LOPACK_RPC_REPLY_ADDRESS);
+
+		/// cancels all pending requests
+		virtual ~RpcClient();
+
+	/// \section Requests
+	///
+	/// note: the sender is shared, so build & send each request from one
+	///       thread at a time
+
+		/// begin a request message on the sender & add the id & reply port,
+		/// add the parameters & call EndMessage, returns the correlation id
+		int32_t beginRequest(std::string_view address);
+
+		/// send the request built after beginRequest() & call back on reply or
+		/// after timeout seconds, returns false if the send failed, the
+		/// callback is not called in that case
+		bool send(int32_t id, double timeout, Callback callback);
+
+		/// send the request built after beginRequest(), the future's result is
+		/// the reply or empty on timeout or if the send failed
+		std::future<std::optional<ReceivedMessage> > send(int32_t id, double timeout);
+
+		/// cancel a pending request, calls its callback with NULL,
+		/// returns false if it was not pending
+		bool cancel(int32_t id);
+
+		/// cancel all pending requests
+		void cancelAll();
+
+	/// \section Util
+
+		/// get the rpc counters
+		RpcStats getStats();
+
+		/// get the reply address
+		inline const std::string& getReplyAddress() {return oscRootAddress;}
+
+	protected:
+
+		/// route replies
+		bool processOscMessage(const ReceivedMessage &message, const MessageSource &source);
+
+	private:
+
+		RpcClient(RpcClient const&);              // not copyable
+		RpcClient& operator = (RpcClient const&); // not assignable
+
+		typedef std::chrono::steady_clock Clock;
+
+		/// an in-flight request
+		struct Pending {
+			Callback callback;
+			std::multimap<Clock::time_point, int32_t>::iterator timer;
+		};
+
+		/// complete & remove a pending request, reply is NULL on timeout
+		bool complete(int32_t id, const ReceivedMessage *reply);
+
+		/// timer thread loop, sweeps timed out requests
+		void sweep();
+
+		OscSender &m_sender;
+		OscReceiver &m_receiver;
+
+		std::mutex m_mutex; ///< guards the pending table, timers, & stats
+		std::condition_variable m_condition;  ///< signals new timers & stop
+		std::unordered_map<int32_t, Pending> m_pending; ///< requests by id
+		std::multimap<Clock::time_point, int32_t> m_timers; ///< ids by deadline
+		int32_t m_nextId;   ///< next correlation id
+		RpcStats m_stats;   ///< counters
+		bool m_sweeping;    ///< keep the timer thread running?
+		std::thread m_sweeper; ///< timer thread
+};
+
+/// \class RpcResponder
+/// \brief replies to rpc requests
+///
+/// replies through a single sender which is pointed at each requesting
+/// peer's pooled destination, see SenderPool, so no per peer state is kept
+/// & the pool bounds the cached destinations; use from a single dispatch
+/// thread:
+///
+///   if(RpcResponder::isRequest(message)) {
+///       int32_t voices = ...; // parameters start at RpcResponder::FIRST_ARG
+///       OscSender &sender = responder.beginReply(message, source);
+///       sender << voices << osc::EndMessage();
+///       sender.send();
+///   }
+class RpcResponder {
+
+	public:
+
+		/// index of the first request parameter
+		static const unsigned int FIRST_ARG = 2;
+
+		RpcResponder(const std::string &replyAddress=LOPACK_RPC_REPLY_ADDRESS);
+		virtual ~RpcResponder();
+
+		/// does the message have the rpc id & reply port arguments?
+		static bool isRequest(const ReceivedMessage &message);
+
+		/// get the correlation id of a request, throws an exception on a bad request
+		static int32_t getId(const ReceivedMessage &request);
+
+		/// begin the reply message to a request & add the id, add the results,
+		/// call EndMessage & send; throws an exception on a bad request
+		OscSender& beginReply(const ReceivedMessage &request, const MessageSource &source);
+
+		/// release the destination of the last reply
+		void clear();
+
+	private:
+
+		RpcResponder(RpcResponder const&);              // not copyable
+		RpcResponder& operator = (RpcResponder const&); // not assignable
+
+		std::string m_replyAddress; ///< reply message address
+		OscSender *m_sender;        ///< reply sender
+		std::string m_host;         ///< host of the sender's current destination
+		int32_t m_port;             ///< port of the sender's current destination, 0 if none
+};
+
+} // namespace
@@ -23,50 +23,165 @@
 #include "OscSender.h"
 
 #include "Log.h"
+#include <algorithm>
+#include <errno.h>
 #include <sstream>
+#include <string.h>
+#include <stdlib.h>
 
 namespace osc {
 
 OscSender::OscSender() : 
 	m_address(NULL), m_message(NULL), m_addressPattern(""),
-	m_messageInProgress(false), m_bundleInProgress(false) {}
+	m_messageInProgress(false), m_bundleInProgress(false),
+	m_pacing(false), m_maxQueued(1024),
+	m_reliableServer(NULL), m_receivingNacks(false), m_maxRetained(256), m_reliableStream("/") {}
 
 OscSender::OscSender(std::string address, unsigned int port) :
 	m_address(NULL), m_message(NULL), m_addressPattern(""),
-	m_messageInProgress(false), m_bundleInProgress(false) {
+	m_messageInProgress(false), m_bundleInProgress(false),
+	m_pacing(false), m_maxQueued(1024),
+	m_reliableServer(NULL), m_receivingNacks(false), m_maxRetained(256), m_reliableStream("/") {
 	setup(address, port);
 }
 
 OscSender::~OscSender() {
+	setReliable(false);
+	std::unique_lock<std::mutex> lock(m_pacingMutex);
+	if(m_pacing) {
+		m_pacing = false;
+		m_pacingCondition.notify_all();
+		lock.unlock();
+		m_pacer.join();
+		lock.lock();
+	}
+	while(!m_queue.empty()) {
+		freePacket(m_queue.front());
+		m_queue.pop_front();
+	}
 	if(m_address) {
 		lo_address_free(m_address);
 	}
+	for(std::unordered_map<std::string, lo_address>::iterator iter = m_groupAddresses.begin();
+	    iter != m_groupAddresses.end(); ++iter) {
+		lo_address_free(iter->second);
+	}
+	for(unsigned int i = 0; i < m_retiredAddresses.size(); ++i) {
+		lo_address_free(m_retiredAddresses[i]);
+	}
 	clear();
 }
 
 void OscSender::setup(std::string address, unsigned int port) {
+	std::lock_guard<std::mutex> lock(m_pacingMutex);
 	if(m_address) {
 		lo_address_free(m_address);
 	}
 	std::stringstream stream;
 	stream << port;
 	m_address = lo_address_new(address.c_str(), stream.str().c_str());
+	m_peer.reset();
+}
+
+bool OscSender::setupPooled(std::string address, unsigned int port, SenderPool &pool) {
+	std::shared_ptr<SenderPool::Peer> peer = pool.acquire(address, port); // may block resolving
+	std::lock_guard<std::mutex> lock(m_pacingMutex);
+	if(m_address) {
+		lo_address_free(m_address);
+		m_address = NULL;
+	}
+	m_peer = peer;
+	m_peerError.clear();
+	return m_peer != nullptr;
+}
+
+void OscSender::setupMulticastGroups(const MulticastGroups &groups, unsigned int port) {
+	std::lock_guard<std::mutex> lock(m_pacingMutex);
+
+	// queued & retained packets may still point to the current addresses
+	for(std::unordered_map<std::string, lo_address>::iterator iter = m_groupAddresses.begin();
+	    iter != m_groupAddresses.end(); ++iter) {
+		m_retiredAddresses.push_back(iter->second);
+	}
+	m_groupAddresses.clear();
+
+	m_groups = groups;
+	std::stringstream stream;
+	stream << port;
+	std::vector<std::string> all = m_groups.getGroups();
+	for(unsigned int i = 0; i < all.size(); ++i) {
+		lo_address address = lo_address_new(all[i].c_str(), stream.str().c_str());
+		if(!address) {
+			LOG_ERROR << "OscSender: could not create address for multicast group "
+			          << all[i] << std::endl;
+			continue;
+		}
+		m_groupAddresses[all[i]] = address;
+	}
 }
 
-void OscSender::send() {
-	if(!m_address || m_bundleInProgress || m_messageInProgress) {
+bool OscSender::send() {
+	if((!m_address && !m_peer && m_groupAddresses.empty()) || m_bundleInProgress || m_messageInProgress) {
 		throw SendException();
 	}
-	if(m_bundles.size() > 0) {
-		lo_send_bundle(m_address, m_bundles.front());
+	if(m_bundles.empty() && !m_message) {
+		throw SendException();
 	}
-	else {
-		if(!m_message) {
-			throw SendException();
+
+	std::lock_guard<std::mutex> lock(m_pacingMutex);
+	lo_address address = target(m_bundles.empty() ? m_addressPattern : m_bundlePattern);
+	if(m_reliableServer) {
+		wrapReliable();
+		m_retained.back().target = address;
+	}
+	if(!isRateLimited()) {
+		int ret = transmit(address, m_bundles.empty() ? NULL : m_bundles.front(),
+		                   m_message, m_addressPattern.c_str());
+		if(ret >= 0) {
+			m_stats.sent++;
 		}
-		lo_send_message(m_address, m_addressPattern.c_str(), m_message);
+		else {
+			m_stats.errors++;
+		}
+		clear(); // keeps the address pattern buffer for the next message
+		return ret >= 0;
+	}
+
+	// take ownership of the message or bundle
+	Packet packet;
+	packet.bundle = m_bundles.empty() ? NULL : m_bundles.front();
+	packet.message = packet.bundle ? NULL : m_message;
+	packet.path = m_addressPattern;
+	packet.target = address;
+	packet.size = 0;
+	m_bundles.clear();
+	m_message = NULL;
+	m_addressPattern.clear();
+	m_bundlePattern.clear();
+
+	refill();
+	if(m_byteBucket.rate > 0) {
+		packet.size = packet.bundle ? lo_bundle_length(packet.bundle) :
+			lo_message_length(packet.message, packet.path.c_str());
 	}
-	clear();
+
+	// queue if there are packets ahead of this one or not enough tokens
+	if(!m_queue.empty() || m_packetBucket.wait() > 0 || m_byteBucket.wait() > 0) {
+		if(m_queue.size() >= m_maxQueued) {
+			m_stats.dropped++;
+			freePacket(packet);
+			return false;
+		}
+		packet.queued = std::chrono::steady_clock::now();
+		m_queue.push_back(packet);
+		m_pacingCondition.notify_all();
+		return true;
+	}
+	m_packetBucket.take(1);
+	m_byteBucket.take(packet.size);
+	int ret = sendPacket(packet);
+	freePacket(packet);
+	return ret >= 0;
 }
 
 void OscSender::clear() {
@@ -77,19 +192,20 @@ void OscSender::clear() {
 	else if(m_message) {
 		lo_message_free(m_message);
 	}
-	m_addressPattern = "";
+	m_addressPattern.clear();
+	m_bundlePattern.clear();
 	m_message = NULL;
 }
 
 // MESSAGE BUILDING
 
-void OscSender::beginMessage(std::string addressPattern) {
+void OscSender::beginMessage(std::string_view addressPattern) {
 	if(m_messageInProgress) {
 		throw MessageInProgressException();
 	}
 	m_message = lo_message_new();
 	m_messageInProgress = true;
-	m_addressPattern = addressPattern;
+	m_addressPattern.assign(addressPattern); // reuses the buffer
 }
 	
 void OscSender::addBool(bool var) {
@@ -153,20 +269,28 @@ void OscSender::addDouble(double var) {
 	lo_message_add_double(m_message, var);
 }
 
-void OscSender::addString(char *var) {
+void OscSender::addString(const char *var) {
 	if(!m_messageInProgress) {
 		throw MessageNotInProgressException();
 	}
 	lo_message_add_string(m_message, var);
 }
 
-void OscSender::addString(std::string var) {
+void OscSender::addString(const std::string &var) {
 	if(!m_messageInProgress) {
 		throw MessageNotInProgressException();
 	}
 	lo_message_add_string(m_message, var.c_str());
 }
 
+void OscSender::addString(std::string_view var) {
+	if(!m_messageInProgress) {
+		throw MessageNotInProgressException();
+	}
+	m_string.assign(var); // liblo needs a null terminated string
+	lo_message_add_string(m_message, m_string.c_str());
+}
+
 void OscSender::addSymbol(const Symbol &var) {
 	if(!m_messageInProgress) {
 		throw MessageNotInProgressException();
@@ -197,6 +321,69 @@ void OscSender::addBlob(const Blob &var) {
 	lo_blob_free(blob);
 }
 
+void OscSender::addArguments(const ReceivedMessage &message) {
+	if(!m_messageInProgress) {
+		throw MessageNotInProgressException();
+	}
+	for(unsigned int i = 0; i < message.numArgs(); ++i) {
+		switch(message.typeTag(i)) {
+			case 'T': case 'F': addBool(message.asBool(i)); break;
+			case 'c': addChar(message.asChar(i)); break;
+			case 'N': addNil(); break;
+			case 'I': addInfinitum(); break;
+			case 'i': addInt32(message.asInt32(i)); break;
+			case 'h': addInt64(message.asInt64(i)); break;
+			case 'f': addFloat(message.asFloat(i)); break;
+			case 'd': addDouble(message.asDouble(i)); break;
+			case 's': addString(message.asString(i)); break;
+			case 'S': addSymbol(message.asSymbol(i)); break;
+			case 'm': // copy raw bytes to keep the original byte order
+				lo_message_add_midi(m_message, (uint8_t *)message.arg(i)->m);
+				break;
+			case 't': addTimeTag(message.asTimeTag(i)); break;
+			case 'b': addBlob(message.asBlob(i)); break;
+			default:
+				throw TypeException("cannot forward unknown argument type");
+		}
+	}
+}
+
+void OscSender::addInt32s(const int32_t *vars, size_t count) {
+	if(!m_messageInProgress) {
+		throw MessageNotInProgressException();
+	}
+	for(size_t i = 0; i < count; ++i) {
+		lo_message_add_int32(m_message, vars[i]);
+	}
+}
+
+void OscSender::addInt64s(const int64_t *vars, size_t count) {
+	if(!m_messageInProgress) {
+		throw MessageNotInProgressException();
+	}
+	for(size_t i = 0; i < count; ++i) {
+		lo_message_add_int64(m_message, vars[i]);
+	}
+}
+
+void OscSender::addFloats(const float *vars, size_t count) {
+	if(!m_messageInProgress) {
+		throw MessageNotInProgressException();
+	}
+	for(size_t i = 0; i < count; ++i) {
+		lo_message_add_float(m_message, vars[i]);
+	}
+}
+
+void OscSender::addDoubles(const double *vars, size_t count) {
+	if(!m_messageInProgress) {
+		throw MessageNotInProgressException();
+	}
+	for(size_t i = 0; i < count; ++i) {
+		lo_message_add_double(m_message, vars[i]);
+	}
+}
+
 void OscSender::endMessage() {
 	if(!m_messageInProgress) {
 		throw MessageNotInProgressException();
@@ -209,6 +396,9 @@ void OscSender::endMessage() {
 		std::copy(m_addressPattern.begin(), m_addressPattern.end(), addressPattern);
 		addressPattern[m_addressPattern.size()] = '\0'; // null terminator
 		lo_bundle_add_message(m_bundles.back(), addressPattern, m_message);
+		if(m_bundlePattern.empty()) { // for the multicast group
+			m_bundlePattern = m_addressPattern;
+		}
 		m_message = NULL;
 		m_addressPattern = "";
 	}
@@ -310,7 +500,12 @@ OscSender& OscSender::operator<<(const char *var) {
 	return *this;
 }
 
-OscSender& OscSender::operator<<(const std::string var) {
+OscSender& OscSender::operator<<(const std::string &var) {
+	addString(var);
+	return *this;
+}
+
+OscSender& OscSender::operator<<(std::string_view var) {
 	addString(var);
 	return *this;
 }
@@ -347,18 +542,339 @@ OscSender& OscSender::operator<<(const EndBundle &var) {
 	return *this;
 }
 
+// RATE LIMITING
+
+void OscSender::TokenBucket::setup(double r, double burstTime) {
+	rate = std::max(r, 0.0);
+	capacity = rate * std::max(burstTime, 0.0);
+	tokens = capacity;
+}
+
+void OscSender::TokenBucket::refill(double seconds) {
+	if(rate > 0) {
+		tokens = std::min(capacity, tokens + rate * seconds);
+	}
+}
+
+double OscSender::TokenBucket::wait() const {
+	return (rate > 0 && tokens < 0) ? -tokens / rate : 0;
+}
+
+void OscSender::TokenBucket::take(double cost) {
+	if(rate > 0) {
+		tokens -= cost;
+	}
+}
+
+void OscSender::setRateLimit(double packetsPerSec, double bytesPerSec,
+                             double burstTime, unsigned int maxQueued) {
+	std::unique_lock<std::mutex> lock(m_pacingMutex);
+	m_packetBucket.setup(packetsPerSec, burstTime);
+	m_byteBucket.setup(bytesPerSec, burstTime);
+	m_lastRefill = std::chrono::steady_clock::now();
+	m_maxQueued = std::max(maxQueued, 1U);
+	if(isRateLimited()) {
+		if(!m_pacing) {
+			m_pacing = true;
+			m_pacer = std::thread(&OscSender::pace, this);
+		}
+		m_pacingCondition.notify_all(); // recompute the wait
+	}
+	else if(m_pacing) {
+		m_pacing = false;
+		m_pacingCondition.notify_all();
+		lock.unlock();
+		m_pacer.join();
+		lock.lock();
+
+		// no limit, send what's left
+		while(!m_queue.empty()) {
+			Packet &packet = m_queue.front();
+			sendPacket(packet);
+			freePacket(packet);
+			m_queue.pop_front();
+		}
+		m_pacingCondition.notify_all();
+	}
+}
+
+bool OscSender::isRateLimited() {
+	return m_packetBucket.rate > 0 || m_byteBucket.rate > 0;
+}
+
+bool OscSender::waitForQueue(double timeout) {
+	std::unique_lock<std::mutex> lock(m_pacingMutex);
+	if(timeout < 0) {
+		while(!m_queue.empty()) {
+			m_pacingCondition.wait(lock);
+		}
+		return true;
+	}
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() +
+		std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+			std::chrono::duration<double>(timeout));
+	while(!m_queue.empty()) {
+		if(m_pacingCondition.wait_until(lock, end) == std::cv_status::timeout) {
+			break;
+		}
+	}
+	return m_queue.empty();
+}
+
+PacingStats OscSender::getPacingStats() {
+	std::lock_guard<std::mutex> lock(m_pacingMutex);
+	PacingStats stats = m_stats;
+	stats.queued = m_queue.size();
+	return stats;
+}
+
+void OscSender::resetPacingStats() {
+	std::lock_guard<std::mutex> lock(m_pacingMutex);
+	m_stats = PacingStats();
+}
+
+// RELIABLE DELIVERY
+
+bool OscSender::setReliable(bool reliable, unsigned int bufferSize) {
+	if(!reliable) {
+		if(m_receivingNacks.load()) { // the NACK callback takes the lock
+			m_receivingNacks.store(false);
+			m_nackThread.join();
+		}
+		std::lock_guard<std::mutex> lock(m_pacingMutex);
+		while(!m_retained.empty()) {
+			lo_bundle_free_recursive(m_retained.front().bundle);
+			m_retained.pop_front();
+		}
+		if(m_reliableServer) {
+			lo_server_free(m_reliableServer);
+			m_reliableServer = NULL;
+		}
+		return true;
+	}
+	std::lock_guard<std::mutex> lock(m_pacingMutex);
+	m_maxRetained = std::max(bufferSize, 1U);
+	while(m_retained.size() > m_maxRetained) {
+		lo_bundle_free_recursive(m_retained.front().bundle);
+		m_retained.pop_front();
+	}
+	if(m_reliableServer) {
+		return true;
+	}
+	m_reliableServer = lo_server_new(NULL, NULL); // any free port
+	if(!m_reliableServer) {
+		LOG_ERROR << "OscSender: could not open reliable delivery socket" << std::endl;
+		return false;
+	}
+	lo_server_add_method(m_reliableServer, LOPACK_RELIABLE_NACK, NULL, &nackCB, this);
+	m_receivingNacks.store(true);
+	m_nackThread = std::thread(&OscSender::receiveNacks, this);
+	return true;
+}
+
+bool OscSender::isReliable() {
+	std::lock_guard<std::mutex> lock(m_pacingMutex);
+	return m_reliableServer != NULL;
+}
+
+void OscSender::setReliableStream(std::string_view stream) {
+	std::lock_guard<std::mutex> lock(m_pacingMutex);
+	m_reliableStream.assign(stream);
+}
+
+ReliableStats OscSender::getReliableStats() {
+	std::lock_guard<std::mutex> lock(m_pacingMutex);
+	return m_reliableStats;
+}
+
 // UTIL
 
 const std::string OscSender::getHostname() const  {
+	if(m_peer) {
+		return m_peer->getHostname();
+	}
 	return m_address ? lo_address_get_hostname(m_address) : "";
 }
 
 const std::string OscSender::getPort() const {
+	if(m_peer) {
+		return m_peer->getPort();
+	}
 	return m_address ? lo_address_get_port(m_address) : 0;
 }
 
 const std::string OscSender::getUrl() const {
-	return m_address ? lo_address_get_url(m_address) : "";
+	if(m_peer) {
+		return m_peer->getUrl();
+	}
+	if(!m_address) {
+		return "";
+	}
+	char *url = lo_address_get_url(m_address);
+	std::string ret = url ? url : "";
+	free(url); // allocated by liblo
+	return ret;
+}
+
+const std::string OscSender::getErrorString() const {
+	if(m_peer) {
+		return m_peerError;
+	}
+	const char *error = m_address ? lo_address_errstr(m_address) : NULL;
+	return (error && lo_address_errno(m_address) != 0) ? error : "";
+}
+
+// PRIVATE
+
+int OscSender::sendPacket(const Packet &packet) {
+	int ret = transmit(packet.target, packet.bundle, packet.message, packet.path.c_str());
+	if(ret >= 0) {
+		m_stats.sent++;
+	}
+	else {
+		m_stats.errors++;
+	}
+	return ret;
+}
+
+int OscSender::transmit(lo_address target, lo_bundle bundle, lo_message message, const char *path) {
+	if(!target && m_peer) {
+		// serialize into the reused buffer & send on the pooled socket,
+		// reliable packets are sent from the NACK socket
+		size_t size = bundle ? lo_bundle_length(bundle) : lo_message_length(message, path);
+		if(m_buffer.size() < size) {
+			m_buffer.resize(size);
+		}
+		if(bundle) {
+			lo_bundle_serialise(bundle, m_buffer.data(), &size);
+		}
+		else {
+			lo_message_serialise(message, path, m_buffer.data(), &size);
+		}
+		int ret = (bundle && m_reliableServer) ?
+			m_peer->sendFrom(lo_server_get_socket_fd(m_reliableServer), m_buffer.data(), size) :
+			m_peer->send(m_buffer.data(), size);
+		if(ret < 0) {
+			m_peerError = strerror(errno);
+		}
+		return ret;
+	}
+	lo_address to = target ? target : m_address;
+	if(!to) {
+		return -1;
+	}
+	if(bundle && m_reliableServer) {
+		return lo_send_bundle_from(to, m_reliableServer, bundle);
+	}
+	if(bundle) {
+		return lo_send_bundle(to, bundle);
+	}
+	return lo_send_message(to, path, message);
+}
+
+void OscSender::freePacket(Packet &packet) {
+	if(packet.bundle) {
+		lo_bundle_free_recursive(packet.bundle);
+	}
+	else if(packet.message) {
+		lo_message_free(packet.message);
+	}
+	packet.bundle = NULL;
+	packet.message = NULL;
+}
+
+lo_address OscSender::target(std::string_view addressPattern) {
+	if(m_groupAddresses.empty()) {
+		return NULL; // use the setup() address
+	}
+	std::unordered_map<std::string, lo_address>::iterator iter =
+		m_groupAddresses.find(m_groups.groupFor(addressPattern));
+	return iter != m_groupAddresses.end() ? iter->second : NULL;
+}
+
+// FNV-1a, truncated to a 32 bit stream id
+static int32_t streamId(std::string_view stream) {
+	return (int32_t) hashString(stream);
+}
+
+void OscSender::wrapReliable() {
+	lo_bundle bundle;
+	int32_t stream;
+	if(m_bundles.empty()) { // wrap the message
+		stream = streamId(m_addressPattern);
+		bundle = lo_bundle_new(LO_TT_IMMEDIATE);
+		// deep copy of the address pattern, see endMessage()
+		char *addressPattern = new char[m_addressPattern.size()+1];
+		std::copy(m_addressPattern.begin(), m_addressPattern.end(), addressPattern);
+		addressPattern[m_addressPattern.size()] = '\0'; // null terminator
+		lo_bundle_add_message(bundle, addressPattern, m_message);
+		m_message = NULL;
+		m_bundles.push_back(bundle);
+	}
+	else {
+		stream = streamId(m_reliableStream);
+		bundle = m_bundles.front();
+	}
+	uint32_t &sequence = m_sequences[stream];
+	lo_message header = lo_message_new();
+	lo_message_add_int32(header, stream);
+	lo_message_add_int32(header, (int32_t) sequence);
+	lo_bundle_add_message(bundle, LOPACK_RELIABLE_HEADER, header);
+
+	// keep a reference for retransmission
+	lo_bundle_incref(bundle);
+	Retained retained = {stream, sequence, bundle, NULL};
+	m_retained.push_back(retained);
+	if(m_retained.size() > m_maxRetained) {
+		lo_bundle_free_recursive(m_retained.front().bundle);
+		m_retained.pop_front();
+	}
+	sequence++; // unsigned, wraps
+	m_reliableStats.sent++;
+}
+
+void OscSender::receiveNacks() {
+	while(m_receivingNacks.load()) {
+		lo_server_recv_noblock(m_reliableServer, 10);
+	}
+}
+
+void OscSender::refill() {
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	double seconds = std::chrono::duration<double>(now - m_lastRefill).count();
+	m_packetBucket.refill(seconds);
+	m_byteBucket.refill(seconds);
+	m_lastRefill = now;
+}
+
+void OscSender::pace() {
+	std::unique_lock<std::mutex> lock(m_pacingMutex);
+	while(m_pacing) {
+		if(m_queue.empty()) {
+			m_pacingCondition.wait(lock);
+			continue;
+		}
+		refill();
+		double wait = std::max(m_packetBucket.wait(), m_byteBucket.wait());
+		if(wait > 0) {
+			m_pacingCondition.wait_for(lock, std::chrono::duration<double>(wait));
+			continue;
+		}
+		Packet &packet = m_queue.front();
+		m_packetBucket.take(1);
+		m_byteBucket.take(packet.size);
+		double delay = std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - packet.queued).count();
+		m_stats.delayed++;
+		m_stats.totalDelay += delay;
+		m_stats.maxDelay = std::max(m_stats.maxDelay, delay);
+		sendPacket(packet);
+		freePacket(packet);
+		m_queue.pop_front();
+		if(m_queue.empty()) {
+			m_pacingCondition.notify_all(); // wake waitForQueue()
+		}
+	}
 }
 
 void OscSender::print() {
@@ -370,4 +886,38 @@ void OscSender::print() {
 	}
 }
 
+// STATIC CALLBACKS
+
+int OscSender::nackCB(const char *path, const char *types, lo_arg **argv,
+                      int argc, lo_message msg, void *user_data) {
+	OscSender *sender = (OscSender *)user_data;
+	if(argc < 1 || types[0] != LO_INT32) {
+		return 0;
+	}
+	std::lock_guard<std::mutex> lock(sender->m_pacingMutex);
+	sender->m_reliableStats.nacksReceived++;
+	int32_t stream = argv[0]->i;
+	for(int i = 1; i < argc; ++i) {
+		if(types[i] != LO_INT32) {
+			continue;
+		}
+		// search newest first, NACKs are usually for recent packets
+		std::deque<Retained>::reverse_iterator iter;
+		for(iter = sender->m_retained.rbegin(); iter != sender->m_retained.rend(); ++iter) {
+			if(iter->stream == stream && iter->sequence == (uint32_t) argv[i]->i) {
+				break;
+			}
+		}
+		if(iter == sender->m_retained.rend()) {
+			sender->m_reliableStats.expired++;
+			continue;
+		}
+		// retransmits are not rate limited, they replace lost packets
+		if(sender->transmit(iter->target, iter->bundle, NULL, NULL) >= 0) {
+			sender->m_reliableStats.retransmits++;
+		}
+	}
+	return 0;
+}
+
 } // namespace
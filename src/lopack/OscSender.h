@@ -29,7 +29,17 @@
 ==============================================================================*/
 #pragma once
 
+#include "OscMulticast.h"
+#include "OscReliable.h"
+#include "OscSenderPool.h"
 #include "OscTypes.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 namespace osc {
@@ -62,6 +72,23 @@ class MessageNotInProgressException : public std::runtime_error {
 			: std::runtime_error(w) {}
 };
 
+/// send & rate limit counters, see OscSender::setRateLimit()
+struct PacingStats {
+	uint64_t sent;       ///< packets sent
+	uint64_t errors;     ///< packets liblo could not send
+	uint64_t delayed;    ///< packets sent after waiting in the queue
+	uint64_t dropped;    ///< packets dropped because the queue was full
+	unsigned int queued; ///< packets currently waiting in the queue
+	double totalDelay;   ///< total seconds delayed packets waited
+	double maxDelay;     ///< longest seconds a delayed packet waited
+
+	PacingStats() : sent(0), errors(0), delayed(0), dropped(0), queued(0),
+		totalDelay(0), maxDelay(0) {}
+
+	/// mean seconds a delayed packet waited
+	double meanDelay() const {return delayed > 0 ? totalDelay / delayed : 0;}
+};
+
 /// \class OscSender
 /// \brief send OSC packets through buffer using << stream
 class OscSender {
@@ -76,8 +103,24 @@ class OscSender {
 		/// see http://tldp.org/HOWTO/Multicast-HOWTO-2.html
 		void setup(std::string address, unsigned int port);
 
+		/// setup the ip address/hostname and port using a shared destination
+		/// from a sender pool, see SenderPool; the address is resolved once
+		/// per pool & sends use the destination's connected socket, returns
+		/// false if the address could not be resolved
+		bool setupPooled(std::string address, unsigned int port,
+		                 SenderPool &pool=SenderPool::shared());
+
+		/// setup to send each packet to the multicast group for its address
+		/// instead of the setup() address, see MulticastGroups; a bundle is
+		/// sent to the group of its first message & addresses without a group
+		/// go to the setup() address, if set; an empty map sends everything
+		/// to the setup() address again
+		void setupMulticastGroups(const MulticastGroups &groups, unsigned int port);
+
 		/// send the current message/bundle(s)
-		void send();
+		/// returns false if liblo could not send, see getErrorString(),
+		/// or if the packet was dropped by the rate limiter
+		bool send();
 	
 		/// clear the current message/bundles(s)
 		void clear();
@@ -86,7 +129,7 @@ class OscSender {
 	
 		/// begin a message and set the osc address pattern,
 		/// can be called within bundles
-		void beginMessage(std::string addressPattern);
+		void beginMessage(std::string_view addressPattern);
 	
 		void addBool(bool var);
 		void addChar(char var);
@@ -99,13 +142,38 @@ class OscSender {
 		void addFloat(float var);
 		void addDouble(double var);
 	
-		void addString(char *var);
-		void addString(std::string var);
+		void addString(const char *var);
+		void addString(const std::string &var);
+		void addString(std::string_view var); ///< copies into a reused buffer for the terminator
 		void addSymbol(const Symbol &var);
 	
 		void addMidiMessage(const MidiMessage &var);
 		void addTimeTag(const TimeTag &var);
 		void addBlob(const Blob &var);
+
+		/// add all arguments from a received message, useful for forwarding
+		void addArguments(const ReceivedMessage &message);
+
+		/// add a run of numeric arguments with a single state check,
+		/// for large frames such as level meters
+		///
+		/// note: liblo stores arguments in host byte order & converts them
+		///       to big endian when the packet is serialized for sending
+		void addInt32s(const int32_t *vars, size_t count);
+		void addInt64s(const int64_t *vars, size_t count);
+		void addFloats(const float *vars, size_t count);
+		void addDoubles(const double *vars, size_t count);
+		
+		/// add a run of numeric arguments from a span, ie. from a received message
+		///
+		/// note: liblo cannot encode the OSC 1.1 array type tags '[' & ']', so
+		///       arrays are sent as flat runs; two adjacent runs of the same
+		///       type cannot be told apart, separate them with another
+		///       argument, ie. a length, see ReceivedMessage::runLength()
+		inline void addInt32s(ArgSpan<int32_t> vars) {addInt32s(vars.data, vars.size);}
+		inline void addInt64s(ArgSpan<int64_t> vars) {addInt64s(vars.data, vars.size);}
+		inline void addFloats(ArgSpan<float> vars) {addFloats(vars.data, vars.size);}
+		inline void addDoubles(ArgSpan<double> vars) {addDoubles(vars.data, vars.size);}
 	
 		/// finish the message before calling send
 		void endMessage();
@@ -136,7 +204,8 @@ class OscSender {
 		OscSender& operator<<(const double var);
 		
 		OscSender& operator<<(const char *var);
-		OscSender& operator<<(const std::string var);
+		OscSender& operator<<(const std::string &var);
+		OscSender& operator<<(std::string_view var);
 		OscSender& operator<<(const Symbol &var);
 		
 		OscSender& operator<<(const MidiMessage &var);
@@ -148,6 +217,62 @@ class OscSender {
 		OscSender& operator<<(const BeginBundle &var);
 		OscSender& operator<<(const EndBundle &var);
 	
+	/// \section Rate Limiting
+	///
+	/// limits the packets/s and/or bytes/s sent to the destination using
+	/// token buckets, packets over the limit are queued & sent evenly paced
+	/// by a background thread, send() then returns true once queued
+	///
+	/// burstTime is the seconds of traffic which may be sent back to back
+	/// after the sender has been idle, 0 paces every packet
+	///
+	/// queued packets are dropped when the sender is destroyed
+	
+		/// set the rate limit, 0 for no limit, removing all limits sends any
+		/// queued packets immediately
+		void setRateLimit(double packetsPerSec, double bytesPerSec=0,
+		                  double burstTime=0, unsigned int maxQueued=1024);
+		
+		/// is a packet or byte rate limit set?
+		bool isRateLimited();
+		
+		/// wait until all queued packets have been sent, timeout in seconds,
+		/// < 0 waits forever, returns false if packets are still queued
+		bool waitForQueue(double timeout=-1);
+		
+		/// get the send & pacing counters
+		PacingStats getPacingStats();
+		
+		/// reset the send & pacing counters
+		void resetPacingStats();
+	
+	/// \section Reliable Delivery
+	///
+	/// opt-in delivery over lossy networks: each packet is sent in a bundle
+	/// with a per stream sequence header & kept in a bounded retransmit
+	/// buffer, a receiver with OscReceiver::setReliable() holds packets after
+	/// a gap & NACKs the missing ones, which are resent from the buffer, so a
+	/// loss is recovered in about one round trip without stalling other
+	/// streams, see ReliableStreams for the format
+	///
+	/// a message's stream is its address, bundles use the stream set with
+	/// setReliableStream(); packets are sent from a local socket which
+	/// receives the NACKs on a background thread
+	
+		/// enable/disable reliable delivery, bufferSize is the max number of
+		/// sent packets kept for retransmission, returns false if the NACK
+		/// socket could not be opened
+		bool setReliable(bool reliable, unsigned int bufferSize=256);
+		
+		/// is reliable delivery enabled?
+		bool isReliable();
+		
+		/// set the stream name for bundles, default "/"
+		void setReliableStream(std::string_view stream);
+		
+		/// get the reliable delivery counters, see ReliableStats
+		ReliableStats getReliableStats();
+	
 	/// \section Util
 	
 		/// is a message currently in progress?
@@ -156,6 +281,9 @@ class OscSender {
 		/// is a bundle currently in progress?
 		inline bool isBundleInProgress() {return m_bundleInProgress;}
 	
+		/// is the sender using a pooled destination?
+		inline bool isPooled() const {return m_peer != nullptr;}
+	
 		/// get the host name or multicast group
 		const std::string getHostname() const;
 
@@ -164,20 +292,118 @@ class OscSender {
 	
 		/// get the host osc url (protocol, address, & port)
 		const std::string getUrl() const;
+
+		/// get the error from the last failed send, empty if none
+		const std::string getErrorString() const;
 	
 		// print the contents of the current message/bundle
 		void print();
 
 	private:
+	
+		OscSender(OscSender const&);              // not copyable
+		OscSender& operator = (OscSender const&); // not assignable
+		
+		/// token bucket, tokens may go negative so a packet larger than the
+		/// bucket is still sent & the next packet waits until the debt is repaid
+		struct TokenBucket {
+			double rate;     ///< tokens per second, 0 = unlimited
+			double capacity; ///< max tokens
+			double tokens;   ///< available tokens
+			TokenBucket() : rate(0), capacity(0), tokens(0) {}
+			void setup(double r, double burstTime);
+			void refill(double seconds);
+			double wait() const; ///< seconds until the bucket has no debt
+			void take(double cost);
+		};
+		
+		/// a message or bundle to send, owned by the packet
+		struct Packet {
+			lo_message message;  ///< message or NULL
+			lo_bundle bundle;    ///< bundle or NULL
+			std::string path;    ///< message address pattern
+			lo_address target;   ///< group address or NULL for the setup() address
+			size_t size;         ///< size in bytes, only set when needed
+			std::chrono::steady_clock::time_point queued; ///< time queued
+		};
+		
+		/// send a packet to its target address, returns liblo's result
+		int sendPacket(const Packet &packet);
+		
+		/// send a bundle or message to a group address or, if NULL, to the
+		/// setup() address or pooled destination; returns < 0 on error,
+		/// call with m_pacingMutex locked
+		int transmit(lo_address target, lo_bundle bundle, lo_message message, const char *path);
+		
+		/// free a packet's message or bundle
+		void freePacket(Packet &packet);
+		
+		/// get the multicast group address for an address pattern, NULL for
+		/// the setup() address; call with m_pacingMutex locked
+		lo_address target(std::string_view addressPattern);
+		
+		/// add tokens for the time since the last refill
+		void refill();
+		
+		/// pacing thread loop, sends queued packets as tokens allow
+		void pace();
+		
+		/// a sent packet kept for retransmission
+		struct Retained {
+			int32_t stream;   ///< stream id
+			uint32_t sequence; ///< sequence number, wraps
+			lo_bundle bundle; ///< the packet, referenced
+			lo_address target; ///< group address or NULL for the setup() address
+		};
+		
+		/// wrap the current message/bundle with a sequence header & retain it,
+		/// call with m_pacingMutex locked
+		void wrapReliable();
+		
+		/// NACK thread loop
+		void receiveNacks();
+		
+		/// static liblo NACK callback
+		static int nackCB(const char *path, const char *types, lo_arg **argv,
+		                  int argc, lo_message msg, void *user_data);
 		
 		lo_address	m_address; ///< host address to send to
+		std::shared_ptr<SenderPool::Peer> m_peer; ///< pooled destination, replaces m_address
+		std::vector<char> m_buffer; ///< serialized packet buffer for pooled sends
+		std::string m_peerError;    ///< error from the last failed pooled send
 		lo_message	m_message; ///< temp message object
 		std::vector<lo_bundle> m_bundles; ///< temp bundle object stack
 
 		std::string m_addressPattern; ///< temp osc address pattern
+		std::string m_bundlePattern;  ///< address pattern of the first bundled message
+		std::string m_string;         ///< temp string argument buffer
 		
 		bool m_messageInProgress; ///< is a message currently being built?
 		bool m_bundleInProgress;  ///< is a bundle currently being built?
+		
+		std::mutex m_pacingMutex; ///< guards the buckets, queue, stats, & sends
+		std::condition_variable m_pacingCondition; ///< queue & limit changes
+		std::thread m_pacer;      ///< pacing thread
+		bool m_pacing;            ///< is the pacing thread running?
+		TokenBucket m_packetBucket; ///< packets/s limit
+		TokenBucket m_byteBucket;   ///< bytes/s limit
+		std::chrono::steady_clock::time_point m_lastRefill; ///< last refill time
+		std::deque<Packet> m_queue; ///< packets waiting to be sent
+		unsigned int m_maxQueued;   ///< max queued packets
+		PacingStats m_stats;        ///< send & pacing counters
+		
+		lo_server m_reliableServer; ///< socket to send from & receive NACKs, NULL if disabled
+		std::thread m_nackThread;   ///< NACK receive thread
+		std::atomic<bool> m_receivingNacks; ///< keep the NACK thread running?
+		std::deque<Retained> m_retained;    ///< retransmit buffer, oldest first
+		unsigned int m_maxRetained;         ///< retransmit buffer size
+		std::unordered_map<int32_t, uint32_t> m_sequences; ///< next sequence number by stream id
+		std::string m_reliableStream;       ///< stream name for bundles
+		ReliableStats m_reliableStats;      ///< sender counters
+		
+		MulticastGroups m_groups; ///< multicast groups by address prefix
+		std::unordered_map<std::string, lo_address> m_groupAddresses; ///< addresses by group
+		std::vector<lo_address> m_retiredAddresses; ///< replaced group addresses, packets may still use them
 };
 
 } // namespace
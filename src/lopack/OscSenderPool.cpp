@@ -0,0 +1,172 @@
+/*==============================================================================
+
+	OscSenderPool.cpp
+
+	lopack: an oscpack-inspired C++ wrapper for liblo
+
+	Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================*/
+#include "OscSenderPool.h"
+
+#include "Log.h"
+#include <string.h>
+
+#ifdef WIN32
+	#include <winsock2.h>
+	#include <ws2tcpip.h>
+	#define CLOSE_SOCKET(s) closesocket(s)
+#else
+	#include <netdb.h>
+	#include <sys/socket.h>
+	#include <unistd.h>
+	#define CLOSE_SOCKET(s) close(s)
+#endif
+
+namespace osc {
+
+// PEER
+
+SenderPool::Peer::~Peer() {
+	if(m_socket >= 0) {
+		CLOSE_SOCKET(m_socket);
+	}
+}
+
+int SenderPool::Peer::send(const void *data, size_t size) {
+	return ::send(m_socket, (const char *) data, size, 0);
+}
+
+int SenderPool::Peer::sendFrom(int socket, const void *data, size_t size) {
+	return ::sendto(socket, (const char *) data, size, 0,
+	                (const struct sockaddr *) m_address.data(), m_address.size());
+}
+
+const std::string SenderPool::Peer::getUrl() const {
+	return "osc.udp://" + m_host + ":" + m_port + "/";
+}
+
+// SENDER POOL
+
+SenderPool::SenderPool(unsigned int maxPeers) : m_maxPeers(maxPeers) {}
+
+SenderPool::~SenderPool() {}
+
+SenderPool& SenderPool::shared() {
+	static SenderPool pool;
+	return pool;
+}
+
+std::shared_ptr<SenderPool::Peer> SenderPool::acquire(const std::string &host, unsigned int port) {
+	std::string service = std::to_string(port);
+	std::string key = host + ":" + service;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::unordered_map<std::string, std::shared_ptr<Peer> >::iterator iter = m_peers.find(key);
+		if(iter != m_peers.end()) {
+			return iter->second;
+		}
+	}
+
+	// resolve without the lock, so other destinations don't wait on it
+	std::shared_ptr<Peer> peer = connect(host, service);
+	if(!peer) {
+		return peer;
+	}
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::pair<std::unordered_map<std::string, std::shared_ptr<Peer> >::iterator, bool> inserted =
+		m_peers.insert(std::make_pair(key, peer));
+	if(!inserted.second) { // another thread connected first, use theirs
+		return inserted.first->second;
+	}
+	if(m_peers.size() > m_maxPeers) {
+		for(std::unordered_map<std::string, std::shared_ptr<Peer> >::iterator iter = m_peers.begin();
+		    iter != m_peers.end();) {
+			if(iter->second.use_count() == 1) {
+				iter = m_peers.erase(iter);
+			}
+			else {
+				++iter;
+			}
+		}
+	}
+	return peer;
+}
+
+unsigned int SenderPool::prune() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	unsigned int removed = 0;
+	for(std::unordered_map<std::string, std::shared_ptr<Peer> >::iterator iter = m_peers.begin();
+	    iter != m_peers.end();) {
+		if(iter->second.use_count() == 1) { // only the pool
+			iter = m_peers.erase(iter);
+			removed++;
+		}
+		else {
+			++iter;
+		}
+	}
+	return removed;
+}
+
+unsigned int SenderPool::size() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_peers.size();
+}
+
+void SenderPool::setMaxPeers(unsigned int maxPeers) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_maxPeers = maxPeers;
+}
+
+// PRIVATE
+
+std::shared_ptr<SenderPool::Peer> SenderPool::connect(const std::string &host, const std::string &port) {
+	struct addrinfo hints, *result = NULL;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_DGRAM;
+	int error = getaddrinfo(host.c_str(), port.c_str(), &hints, &result);
+	if(error != 0 || !result) {
+		LOG_ERROR << "SenderPool: could not resolve " << host << ":" << port
+		          << ": " << gai_strerror(error) << std::endl;
+		return std::shared_ptr<Peer>();
+	}
+	std::shared_ptr<Peer> peer(new Peer);
+	peer->m_host = host;
+	peer->m_port = port;
+	for(struct addrinfo *info = result; info != NULL; info = info->ai_next) {
+		int s = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+		if(s < 0) {
+			continue;
+		}
+		if(::connect(s, info->ai_addr, info->ai_addrlen) == 0) {
+			peer->m_socket = s;
+			const unsigned char *address = (const unsigned char *) info->ai_addr;
+			peer->m_address.assign(address, address + info->ai_addrlen);
+			break;
+		}
+		CLOSE_SOCKET(s);
+	}
+	freeaddrinfo(result);
+	if(peer->m_socket < 0) {
+		LOG_ERROR << "SenderPool: could not connect a socket to " << host << ":" << port << std::endl;
+		return std::shared_ptr<Peer>();
+	}
+	return peer;
+}
+
+} // namespace
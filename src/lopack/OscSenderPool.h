@@ -0,0 +1,122 @@
+/*==============================================================================
+
+	OscSenderPool.h
+
+	lopack: an oscpack-inspired C++ wrapper for liblo
+
+	Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================*/
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace osc {
+
+/// \class SenderPool
+/// \brief process-wide cache of resolved destinations & connected sockets
+///
+/// a destination is resolved once per host & port & gets a connected udp
+/// socket, so sends skip the per-send address resolution & route lookup;
+/// senders set up with OscSender::setupPooled() share the destination's
+/// socket, making them cheap to create & destroy for transient peers
+///
+/// unused destinations stay cached until pruned or the pool is over its max
+/// size, at which point unused destinations are pruned on the next acquire
+///
+/// note: a connected socket reports ICMP errors, ie. "connection refused"
+///       when nothing is listening on the port, as failed sends
+class SenderPool {
+
+	public:
+
+		/// \class Peer
+		/// \brief a resolved destination & its connected udp socket
+		class Peer {
+
+			public:
+
+				~Peer();
+
+				/// send a datagram on the connected socket,
+				/// returns the bytes sent or -1 on error
+				int send(const void *data, size_t size);
+
+				/// send a datagram to the destination from another udp socket,
+				/// ie. to receive replies on it, returns the bytes sent or -1
+				int sendFrom(int socket, const void *data, size_t size);
+
+				/// get the host name & port as given
+				inline const std::string& getHostname() const {return m_host;}
+				inline const std::string& getPort() const {return m_port;}
+
+				/// get the osc url (protocol, address, & port)
+				const std::string getUrl() const;
+
+			private:
+
+				friend class SenderPool;
+
+				Peer() : m_socket(-1) {}
+
+				Peer(Peer const&);              // not copyable
+				Peer& operator = (Peer const&); // not assignable
+
+				std::string m_host; ///< host name
+				std::string m_port; ///< port
+				int m_socket;       ///< connected socket
+				std::vector<unsigned char> m_address; ///< resolved socket address
+		};
+
+		/// set the max number of cached destinations before pruning
+		SenderPool(unsigned int maxPeers=256);
+		virtual ~SenderPool();
+
+		/// get the process-wide pool
+		static SenderPool& shared();
+
+		/// get the destination for a host & port, resolving & connecting on
+		/// first use, returns NULL & logs on error
+		std::shared_ptr<Peer> acquire(const std::string &host, unsigned int port);
+
+		/// remove cached destinations which are not in use,
+		/// returns the number removed
+		unsigned int prune();
+
+		/// get the number of cached destinations
+		unsigned int size();
+
+		/// set the max number of cached destinations before pruning
+		void setMaxPeers(unsigned int maxPeers);
+
+	private:
+
+		SenderPool(SenderPool const&);              // not copyable
+		SenderPool& operator = (SenderPool const&); // not assignable
+
+		/// resolve a host & port & connect a socket, NULL on error
+		static std::shared_ptr<Peer> connect(const std::string &host, const std::string &port);
+
+		std::mutex m_mutex; ///< guards the peers
+		std::unordered_map<std::string, std::shared_ptr<Peer> > m_peers; ///< by host:port
+		unsigned int m_maxPeers; ///< max cached peers
+};
+
+} // namespace
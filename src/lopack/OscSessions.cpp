@@ -0,0 +1,184 @@
+/*==============================================================================
+
+	OscSessions.cpp
+
+	lopack: an oscpack-inspired C++ wrapper for liblo
+
+	Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================*/
+#include "OscSessions.h"
+
+namespace osc {
+
+// SESSION
+
+Session::Session(const SourceKey &key, const TimeTag &arrival) :
+	m_key(key), m_first(pack(arrival)), m_last(pack(arrival)), m_messages(1),
+	m_userData(NULL), m_removed(false) {}
+
+TimeTag Session::getFirstSeen() const {
+	return unpack(m_first);
+}
+
+TimeTag Session::getLastSeen() const {
+	return unpack(m_last.load(std::memory_order_relaxed));
+}
+
+double Session::getIdleTime() const {
+	return getLastSeen().diff();
+}
+
+void Session::touch(const TimeTag &arrival) {
+	m_last.store(pack(arrival), std::memory_order_relaxed);
+	m_messages.fetch_add(1, std::memory_order_relaxed);
+}
+
+// SESSION TABLE
+
+SessionTable::SessionTable(double timeout) :
+	m_timeout(0), m_nextSweep(0), m_expireCB(NULL), m_expireUserData(NULL) {
+	setTimeout(timeout);
+}
+
+void SessionTable::touch(const SourceKey &key, const TimeTag &arrival) {
+	std::shared_ptr<Session> &cached = m_cache[SourceKey::Hash()(key) % CACHE_SIZE];
+	if(cached && cached->m_key == key && !cached->m_removed.load(std::memory_order_acquire)) {
+		cached->touch(arrival);
+		return;
+	}
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Sessions::iterator iter = m_sessions.find(key);
+	if(iter != m_sessions.end()) {
+		iter->second->touch(arrival);
+		cached = iter->second;
+	}
+	else {
+		cached = std::make_shared<Session>(key, arrival);
+		m_sessions.emplace(key, cached);
+	}
+}
+
+std::shared_ptr<Session> SessionTable::find(const SourceKey &key) const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Sessions::const_iterator iter = m_sessions.find(key);
+	if(iter == m_sessions.end()) {
+		return std::shared_ptr<Session>();
+	}
+	return iter->second;
+}
+
+std::vector<std::shared_ptr<Session> > SessionTable::snapshot() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::vector<std::shared_ptr<Session> > sessions;
+	sessions.reserve(m_sessions.size());
+	Sessions::const_iterator iter;
+	for(iter = m_sessions.begin(); iter != m_sessions.end(); ++iter) {
+		sessions.push_back(iter->second);
+	}
+	return sessions;
+}
+
+bool SessionTable::remove(const SourceKey &key) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Sessions::iterator iter = m_sessions.find(key);
+	if(iter == m_sessions.end()) {
+		return false;
+	}
+	erase(iter);
+	return true;
+}
+
+void SessionTable::clear() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	while(!m_sessions.empty()) {
+		erase(m_sessions.begin());
+	}
+}
+
+unsigned int SessionTable::size() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_sessions.size();
+}
+
+void SessionTable::setTimeout(double timeout) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_timeout = timeout > 0 ? (uint64_t)(timeout * 4294967296.0) : 0;
+	m_nextSweep = 0;
+}
+
+double SessionTable::getTimeout() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_timeout / 4294967296.0;
+}
+
+void SessionTable::setExpireCallback(ExpireCB callback, void *userData) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_expireCB = callback;
+	m_expireUserData = userData;
+}
+
+unsigned int SessionTable::expire() {
+	std::vector<std::shared_ptr<Session> > expired;
+	ExpireCB callback;
+	void *userData;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if(m_timeout == 0) {
+			return 0;
+		}
+		TimeTag now(0, 0);
+		now.now();
+		uint64_t packedNow = Session::pack(now);
+		if(packedNow < m_nextSweep) {
+			return 0;
+		}
+		uint64_t interval = m_timeout / 4;
+		if(interval > 4294967296ULL) {
+			interval = 4294967296ULL; // 1 s
+		}
+		m_nextSweep = packedNow + interval;
+		Sessions::iterator iter = m_sessions.begin();
+		while(iter != m_sessions.end()) {
+			uint64_t last = iter->second->m_last.load(std::memory_order_relaxed);
+			if(last < packedNow && packedNow - last > m_timeout) {
+				expired.push_back(iter->second);
+				erase(iter++);
+			}
+			else {
+				++iter;
+			}
+		}
+		callback = m_expireCB;
+		userData = m_expireUserData;
+	}
+	if(callback) {
+		for(unsigned int i = 0; i < expired.size(); ++i) {
+			callback(*expired[i], userData);
+		}
+	}
+	return expired.size();
+}
+
+// PRIVATE
+
+void SessionTable::erase(Sessions::iterator iter) {
+	// a cached copy may still be touched until touch() sees the flag
+	iter->second->m_removed.store(true, std::memory_order_release);
+	m_sessions.erase(iter);
+}
+
+} // namespace
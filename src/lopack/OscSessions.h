@@ -0,0 +1,181 @@
+/*==============================================================================
+
+	OscSessions.h
+
+	lopack: an oscpack-inspired C++ wrapper for liblo
+
+	Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================*/
+#pragma once
+
+#include "OscTypes.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace osc {
+
+/// \class Session
+/// \brief per source state, updated by the receive thread
+///
+/// counters & times are atomic so a session can be read from any thread
+/// while messages arrive; the user data is not owned by the session, free
+/// it from the table's expire callback
+class Session {
+
+	public:
+
+		/// constructor with the source's key & first arrival time
+		Session(const SourceKey &key, const TimeTag &arrival);
+
+		/// get the source key
+		inline const SourceKey& getKey() const {return m_key;}
+
+		/// get the number of messages received from the source
+		inline uint64_t getMessages() const {return m_messages.load(std::memory_order_relaxed);}
+
+		/// get the arrival time of the first message
+		TimeTag getFirstSeen() const;
+
+		/// get the arrival time of the latest message
+		TimeTag getLastSeen() const;
+
+		/// get the seconds since the latest message
+		double getIdleTime() const;
+
+		/// set/get user data for the source, NULL by default
+		inline void setUserData(void *userData) {m_userData.store(userData);}
+		inline void* getUserData() const {return m_userData.load();}
+
+		/// count a message arriving at the given time
+		void touch(const TimeTag &arrival);
+
+	private:
+
+		Session(Session const&);              // not copyable
+		Session& operator = (Session const&); // not assignable
+
+		/// pack a time tag into 64 bits so it can be stored atomically
+		static inline uint64_t pack(const TimeTag &tag) {
+			return ((uint64_t) tag.sec << 32) | tag.frac;
+		}
+
+		/// unpack a time tag
+		static inline TimeTag unpack(uint64_t packed) {
+			return TimeTag((uint32_t)(packed >> 32), (uint32_t) packed);
+		}
+
+		friend class SessionTable;
+
+		const SourceKey m_key;  ///< source socket address
+		const uint64_t m_first; ///< packed first arrival time
+		std::atomic<uint64_t> m_last;     ///< packed latest arrival time
+		std::atomic<uint64_t> m_messages; ///< messages received
+		std::atomic<void *> m_userData;   ///< user data, not owned
+		std::atomic<bool> m_removed;      ///< removed from the table?
+};
+
+/// \class SessionTable
+/// \brief sessions by source socket address
+///
+/// messages are counted to the session for their source's binary key, see
+/// MessageSource::getKey(), so per client lookups hash a few bytes instead
+/// of a url string; sessions which have been idle longer than the timeout
+/// are removed by expire()
+///
+/// sessions are shared pointers so a session can be held & read after it
+/// has been removed from the table
+///
+/// touch() keeps a small cache of recent sessions by key which only it uses,
+/// so counting a message from a known source takes no lock; call it from
+/// one thread only, ie. the receive thread
+class SessionTable {
+
+	public:
+
+		/// called from expire() for each removed session, ie. to free the
+		/// session's user data
+		typedef void (*ExpireCB)(Session &session, void *userData);
+
+		/// constructor with the idle timeout in seconds, 0 keeps sessions
+		/// until removed
+		SessionTable(double timeout=0);
+		virtual ~SessionTable() {}
+
+		/// count a message arriving from a source, creating its session,
+		/// lock-free if the source's session is cached
+		void touch(const SourceKey &key, const TimeTag &arrival);
+
+		/// get the session for a source, returns NULL if not found
+		std::shared_ptr<Session> find(const SourceKey &key) const;
+
+		/// get all current sessions
+		std::vector<std::shared_ptr<Session> > snapshot() const;
+
+		/// remove a source's session, returns false if not found
+		/// note: the expire callback is not called
+		bool remove(const SourceKey &key);
+
+		/// remove all sessions
+		/// note: the expire callback is not called
+		void clear();
+
+		/// get the number of sessions
+		unsigned int size() const;
+
+		/// set/get the idle timeout in seconds, 0 keeps sessions until removed
+		void setTimeout(double timeout);
+		double getTimeout() const;
+
+		/// set a callback for expired sessions, set to NULL to disable
+		void setExpireCallback(ExpireCB callback, void *userData=NULL);
+
+		/// remove idle sessions, sweeps the table at most every quarter
+		/// timeout (or second, if shorter) so this can be called often,
+		/// returns the number removed
+		unsigned int expire();
+
+	private:
+
+		SessionTable(SessionTable const&);              // not copyable
+		SessionTable& operator = (SessionTable const&); // not assignable
+
+		/// sessions by source
+		typedef std::unordered_map<SourceKey, std::shared_ptr<Session>, SourceKey::Hash> Sessions;
+
+		/// remove a session from the table, the mutex must be locked
+		void erase(Sessions::iterator iter);
+
+		/// touch cache size
+		static const unsigned int CACHE_SIZE = 64;
+
+		Sessions m_sessions; ///< by source
+		mutable std::mutex m_mutex; ///< guards the sessions & settings
+
+		/// recent sessions by key hash, only used by touch(); entries whose
+		/// session has been removed are replaced on the next touch
+		std::shared_ptr<Session> m_cache[CACHE_SIZE];
+
+		uint64_t m_timeout;   ///< idle timeout in 1/2^32 seconds, 0 if none
+		uint64_t m_nextSweep; ///< packed time of the next expire sweep
+		ExpireCB m_expireCB;  ///< expired session callback
+		void *m_expireUserData; ///< expired session callback user data
+};
+
+} // namespace
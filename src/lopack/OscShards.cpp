@@ -0,0 +1,136 @@
+/*==============================================================================
+
+	OscShards.cpp
+
+	lopack: an oscpack-inspired C++ wrapper for liblo
+
+	Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================*/
+#include "OscShards.h"
+
+#include <algorithm>
+#include <new>
+
+namespace osc {
+
+DispatchShards::DispatchShards(unsigned int numWorkers, unsigned int capacity,
+                               DispatchCB callback, void *userData) :
+	m_key(ADDRESS), m_callback(callback), m_userData(userData), m_running(true) {
+	numWorkers = std::max(numWorkers, 1U);
+	unsigned int size = 1;
+	while(size < capacity) {
+		size <<= 1;
+	}
+	for(unsigned int i = 0; i < numWorkers; ++i) {
+		Worker *worker = new Worker;
+		worker->items = (Item *) ::operator new(size * sizeof(Item)); // raw storage
+		worker->mask = size - 1;
+		m_workers.push_back(worker);
+	}
+	for(unsigned int i = 0; i < numWorkers; ++i) {
+		m_workers[i]->thread = std::thread(&DispatchShards::run, this, m_workers[i]);
+	}
+}
+
+DispatchShards::~DispatchShards() {
+	m_running.store(false);
+	for(unsigned int i = 0; i < m_workers.size(); ++i) {
+		Worker &worker = *m_workers[i];
+		{
+			std::lock_guard<std::mutex> lock(worker.mutex);
+			worker.condition.notify_one();
+		}
+		worker.thread.join();
+		::operator delete(worker.items);
+		delete m_workers[i];
+	}
+}
+
+bool DispatchShards::push(std::string_view key, const ReceivedMessage &message,
+                          const MessageSource &source) {
+	Worker &worker = *m_workers[hash(key) % m_workers.size()];
+	uint64_t tail = worker.tail.load(std::memory_order_relaxed);
+	if(tail - worker.head.load(std::memory_order_acquire) > worker.mask) {
+		worker.dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	new (&worker.items[tail & worker.mask]) Item(message, source);
+	worker.tail.store(tail + 1, std::memory_order_seq_cst);
+	if(worker.waiting.load(std::memory_order_seq_cst)) {
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		worker.condition.notify_one();
+	}
+	return true;
+}
+
+void DispatchShards::flush() {
+	for(unsigned int i = 0; i < m_workers.size(); ++i) {
+		Worker &worker = *m_workers[i];
+		uint64_t tail = worker.tail.load(std::memory_order_acquire);
+		while(worker.head.load(std::memory_order_acquire) < tail) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+}
+
+ShardStats DispatchShards::getStats(unsigned int worker) const {
+	ShardStats stats;
+	if(worker >= m_workers.size()) {
+		return stats;
+	}
+	const Worker &w = *m_workers[worker];
+	uint64_t head = w.head.load(std::memory_order_acquire);
+	uint64_t tail = w.tail.load(std::memory_order_acquire);
+	stats.dispatched = head;
+	stats.queued = tail;
+	stats.dropped = w.dropped.load(std::memory_order_relaxed);
+	stats.depth = (unsigned int) (tail - head);
+	return stats;
+}
+
+uint64_t DispatchShards::hash(std::string_view key) {
+	return hashString(key);
+}
+
+// PRIVATE
+
+void DispatchShards::run(Worker *worker) {
+	while(m_running.load()) {
+		dispatch(*worker);
+		std::unique_lock<std::mutex> lock(worker->mutex);
+		worker->waiting.store(true, std::memory_order_seq_cst);
+		// recheck after flagging so a push in between isn't missed
+		if(worker->head.load(std::memory_order_relaxed) == worker->tail.load(std::memory_order_seq_cst) &&
+		   m_running.load()) {
+			worker->condition.wait_for(lock, std::chrono::milliseconds(10));
+		}
+		worker->waiting.store(false);
+	}
+	dispatch(*worker); // finish anything queued before stopping
+}
+
+void DispatchShards::dispatch(Worker &worker) {
+	uint64_t head = worker.head.load(std::memory_order_relaxed);
+	while(head != worker.tail.load(std::memory_order_acquire)) {
+		Item &item = worker.items[head & worker.mask];
+		m_callback(item.message, item.source, m_userData);
+		item.~Item();
+		worker.head.store(++head, std::memory_order_release); // slot can be reused
+	}
+}
+
+} // namespace
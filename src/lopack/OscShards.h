@@ -0,0 +1,147 @@
+/*==============================================================================
+
+	OscShards.h
+
+	lopack: an oscpack-inspired C++ wrapper for liblo
+
+	Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================*/
+#pragma once
+
+#include "OscTypes.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace osc {
+
+/// per worker counters
+struct ShardStats {
+	uint64_t queued;     ///< messages queued
+	uint64_t dispatched; ///< messages dispatched
+	uint64_t dropped;    ///< messages shed because the queue was full
+	unsigned int depth;  ///< messages queued or being dispatched, the backlog
+
+	ShardStats() : queued(0), dispatched(0), dropped(0), depth(0) {}
+};
+
+/// \class DispatchShards
+/// \brief a pool of dispatch threads which keeps per key message order
+///
+/// each message is queued to the worker chosen by hashing its key, so
+/// messages with the same key are always dispatched in order by the same
+/// thread while different keys are dispatched in parallel; each worker has
+/// a lock-free single producer, single consumer queue fed by the receive
+/// thread, a full queue sheds new messages
+///
+/// the workers run from construction until destruction
+class DispatchShards {
+
+	public:
+
+		/// what to hash to choose a worker
+		enum Key {
+			ADDRESS, ///< the message address
+			OBJECT   ///< the longest matching OscObject root address,
+			         ///  falls back to the address if no object matches;
+			         ///  OscReceiver then only passes each message to the
+			         ///  object it matched, so each top-level object is
+			         ///  called from one thread
+		};
+
+		/// called from the worker threads to dispatch a message
+		typedef void (*DispatchCB)(const ReceivedMessage &message,
+		                           const MessageSource &source, void *userData);
+
+		/// start numWorkers threads with the max queued messages per worker,
+		/// rounded up to a power of 2
+		DispatchShards(unsigned int numWorkers, unsigned int capacity,
+		               DispatchCB callback, void *userData);
+
+		/// stops the workers, queued messages are dispatched first
+		virtual ~DispatchShards();
+
+		/// set what to hash, default ADDRESS
+		/// note: not thread safe, set before starting the receiver
+		inline void setKey(Key key) {m_key = key;}
+		inline Key getKey() const {return m_key;}
+
+		/// get the number of workers
+		inline unsigned int getNumWorkers() const {return m_workers.size();}
+
+		/// queue a message for the worker chosen by a key, called from the
+		/// receive thread only, returns false if the queue was full & the
+		/// message dropped
+		bool push(std::string_view key, const ReceivedMessage &message,
+		          const MessageSource &source);
+
+		/// wait until all queued messages have been dispatched
+		void flush();
+
+		/// get the counters for a worker, safe to call from any thread
+		ShardStats getStats(unsigned int worker) const;
+
+		/// hash a key, FNV-1a
+		static uint64_t hash(std::string_view key);
+
+	private:
+
+		DispatchShards(DispatchShards const&);              // not copyable
+		DispatchShards& operator = (DispatchShards const&); // not assignable
+
+		/// a queued message, which clones the liblo message so only the
+		/// worker thread references it, see ReceivedMessage::clone()
+		struct Item {
+			ReceivedMessage message;
+			MessageSource source;
+			Item(const ReceivedMessage &m, const MessageSource &s) : message(m.clone()), source(s) {}
+		};
+
+		/// a worker thread & its single producer, single consumer ring,
+		/// head advances after an item is dispatched so the depth includes it;
+		/// the ring is allocated up front & items are constructed in place
+		struct Worker {
+			Item *items;   ///< ring buffer storage
+			uint64_t mask; ///< capacity - 1
+			std::atomic<uint64_t> head; ///< next to dispatch
+			char padding[64];           ///< keep head & tail on separate cache lines
+			std::atomic<uint64_t> tail; ///< next to push
+			std::atomic<uint64_t> dropped; ///< shed messages
+			std::atomic<bool> waiting;     ///< is the worker waiting?
+			std::mutex mutex;                   ///< for waiting only
+			std::condition_variable condition; ///< signals queued messages
+			std::thread thread;
+			Worker() : items(NULL), mask(0), head(0), tail(0), dropped(0), waiting(false) {}
+		};
+
+		/// worker thread loop
+		void run(Worker *worker);
+
+		/// dispatch everything queued for a worker
+		void dispatch(Worker &worker);
+
+		std::vector<Worker*> m_workers; ///< workers
+		Key m_key;                      ///< what to hash
+		DispatchCB m_callback;          ///< dispatch callback
+		void *m_userData;               ///< callback user data
+		std::atomic<bool> m_running;    ///< keep the workers running?
+};
+
+} // namespace
@@ -0,0 +1,282 @@
+/*==============================================================================
+
+	OscState.cpp
+
+	lopack: an oscpack-inspired C++ wrapper for liblo
+
+	Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================*/
+#include "OscState.h"
+
+#include <string.h>
+
+namespace osc {
+
+static_assert(LOPACK_STATE_MAX_VALUES <= 8, "state type tags are packed into 64 bits");
+
+// STATE VALUE
+
+char StateValue::typeTag(unsigned int at) const {
+	if(at >= numValues) {
+		throw ArgException();
+	}
+	return types[at];
+}
+
+bool StateValue::isNumber(unsigned int at) const {
+	switch(typeTag(at)) {
+		case LO_TRUE: case LO_FALSE: case LO_CHAR:
+		case LO_INT32: case LO_INT64: case LO_FLOAT: case LO_DOUBLE:
+			return true;
+		default:
+			return false;
+	}
+}
+
+bool StateValue::asBool(unsigned int at) const {
+	return asDouble(at) != 0;
+}
+
+int32_t StateValue::asInt32(unsigned int at) const {
+	if(typeTag(at) == LO_INT32) {
+		return (int32_t)(uint32_t) bits[at];
+	}
+	return (int32_t) asDouble(at);
+}
+
+int64_t StateValue::asInt64(unsigned int at) const {
+	if(typeTag(at) == LO_INT64) {
+		return (int64_t) bits[at];
+	}
+	return (int64_t) asDouble(at);
+}
+
+float StateValue::asFloat(unsigned int at) const {
+	if(typeTag(at) == LO_FLOAT) {
+		float f;
+		uint32_t word = (uint32_t) bits[at];
+		memcpy(&f, &word, sizeof(f));
+		return f;
+	}
+	return (float) asDouble(at);
+}
+
+double StateValue::asDouble(unsigned int at) const {
+	switch(typeTag(at)) {
+		case LO_TRUE:
+			return 1;
+		case LO_FALSE:
+			return 0;
+		case LO_CHAR:
+			return (char) bits[at];
+		case LO_INT32:
+			return (int32_t)(uint32_t) bits[at];
+		case LO_INT64:
+			return (double)(int64_t) bits[at];
+		case LO_FLOAT:
+			return asFloat(at);
+		case LO_DOUBLE: {
+			double d;
+			memcpy(&d, &bits[at], sizeof(d));
+			return d;
+		}
+		default:
+			throw TypeException();
+	}
+}
+
+TimeTag StateValue::asTimeTag(unsigned int at) const {
+	if(typeTag(at) != LO_TIMETAG) {
+		throw TypeException();
+	}
+	return TimeTag((uint32_t)(bits[at] >> 32), (uint32_t) bits[at]);
+}
+
+// STATE STORE
+
+StateStore::StateStore(unsigned int capacity) :
+	m_slots(new Slot[capacity]), m_capacity(capacity), m_size(0),
+	m_index(new std::atomic<int32_t>[AddressTable::maxId()+1]), m_maxId(AddressTable::maxId()) {
+	for(unsigned int i = 0; i < capacity; ++i) {
+		Slot &slot = m_slots[i];
+		slot.sequence.store(0, std::memory_order_relaxed);
+		slot.arrival.store(0, std::memory_order_relaxed);
+		slot.types.store(0, std::memory_order_relaxed);
+		slot.numValues.store(0, std::memory_order_relaxed);
+		slot.id = 0;
+		for(unsigned int j = 0; j < LOPACK_STATE_MAX_VALUES; ++j) {
+			slot.bits[j].store(0, std::memory_order_relaxed);
+		}
+	}
+	for(AddressId id = 0; id <= m_maxId; ++id) {
+		m_index[id].store(-1, std::memory_order_relaxed);
+	}
+}
+
+StateStore::~StateStore() {
+	delete [] m_slots;
+	delete [] m_index;
+}
+
+// REGISTRATION
+
+int StateStore::add(std::string_view address) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	AddressId id = AddressTable::intern(address);
+	if(id == 0 || id > m_maxId) {
+		return -1;
+	}
+	int32_t index = m_index[id].load(std::memory_order_relaxed);
+	if(index >= 0) {
+		return index;
+	}
+	unsigned int size = m_size.load(std::memory_order_relaxed);
+	if(size >= m_capacity) {
+		return -1;
+	}
+	m_slots[size].id = id;
+	m_size.store(size + 1, std::memory_order_release);
+	m_index[id].store(size, std::memory_order_release);
+	return size;
+}
+
+int StateStore::find(std::string_view address) const {
+	AddressId id = AddressTable::find(address);
+	if(id == 0 || id > m_maxId) {
+		return -1;
+	}
+	return m_index[id].load(std::memory_order_acquire);
+}
+
+std::string_view StateStore::getAddress(int index) const {
+	if(index < 0 || (unsigned int) index >= size()) {
+		return std::string_view();
+	}
+	return AddressTable::address(m_slots[index].id);
+}
+
+// READING
+
+bool StateStore::read(int index, StateValue &value) const {
+	if(index < 0 || (unsigned int) index >= size()) {
+		return false;
+	}
+	const Slot &slot = m_slots[index];
+	uint64_t before, after;
+	do {
+		before = slot.sequence.load(std::memory_order_acquire);
+		while(before & 1) { // being written, the writer only holds it briefly
+			before = slot.sequence.load(std::memory_order_acquire);
+		}
+		uint64_t arrival = slot.arrival.load(std::memory_order_relaxed);
+		uint64_t types = slot.types.load(std::memory_order_relaxed);
+		unsigned int numValues = slot.numValues.load(std::memory_order_relaxed);
+		for(unsigned int i = 0; i < LOPACK_STATE_MAX_VALUES; ++i) {
+			value.bits[i] = slot.bits[i].load(std::memory_order_relaxed);
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		after = slot.sequence.load(std::memory_order_relaxed);
+		value.arrival = TimeTag((uint32_t)(arrival >> 32), (uint32_t) arrival);
+		value.numValues = numValues;
+		for(unsigned int i = 0; i < LOPACK_STATE_MAX_VALUES; ++i) {
+			value.types[i] = (char)(types >> (i * 8));
+		}
+	} while(before != after);
+	value.types[value.numValues] = '\0';
+	value.updates = before / 2;
+	return true;
+}
+
+bool StateStore::read(std::string_view address, StateValue &value) const {
+	return read(find(address), value);
+}
+
+uint64_t StateStore::getUpdates(int index) const {
+	if(index < 0 || (unsigned int) index >= size()) {
+		return 0;
+	}
+	return m_slots[index].sequence.load(std::memory_order_acquire) / 2;
+}
+
+// WRITING
+
+bool StateStore::update(const ReceivedMessage &message) {
+	AddressId id = message.addressId();
+	if(id == 0 || id > m_maxId) {
+		return false;
+	}
+	int32_t index = m_index[id].load(std::memory_order_acquire);
+	if(index < 0) {
+		return false;
+	}
+
+	// decode before taking the slot so the write section stays short
+	lo_message msg = message.message();
+	const char *types = lo_message_get_types(msg);
+	lo_arg **argv = lo_message_get_argv(msg);
+	unsigned int numValues = 0;
+	uint64_t packedTypes = 0;
+	uint64_t bits[LOPACK_STATE_MAX_VALUES] = {0};
+	for(; types && types[numValues] != '\0' && numValues < LOPACK_STATE_MAX_VALUES; ++numValues) {
+		char tag = types[numValues];
+		lo_arg *arg = argv[numValues];
+		packedTypes |= (uint64_t)(unsigned char) tag << (numValues * 8);
+		switch(tag) {
+			case LO_CHAR:
+				bits[numValues] = (unsigned char) arg->c;
+				break;
+			case LO_INT32:
+				bits[numValues] = (uint32_t) arg->i;
+				break;
+			case LO_FLOAT: {
+				uint32_t word;
+				memcpy(&word, &arg->f, sizeof(word));
+				bits[numValues] = word;
+				break;
+			}
+			case LO_INT64: case LO_DOUBLE: // may be only 4 byte aligned
+				memcpy(&bits[numValues], arg, sizeof(uint64_t));
+				break;
+			case LO_TIMETAG:
+				bits[numValues] = ((uint64_t) arg->t.sec << 32) | arg->t.frac;
+				break;
+			default: // no value or not kept
+				break;
+		}
+	}
+	TimeTag time = message.getArrivalTime();
+	uint64_t arrival = ((uint64_t) time.sec << 32) | time.frac;
+
+	// claim the slot, only contended if several receivers share the store
+	Slot &slot = m_slots[index];
+	uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+	while((sequence & 1) ||
+	      !slot.sequence.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire)) {
+		sequence = slot.sequence.load(std::memory_order_relaxed);
+	}
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.arrival.store(arrival, std::memory_order_relaxed);
+	slot.types.store(packedTypes, std::memory_order_relaxed);
+	slot.numValues.store(numValues, std::memory_order_relaxed);
+	for(unsigned int i = 0; i < LOPACK_STATE_MAX_VALUES; ++i) {
+		slot.bits[i].store(bits[i], std::memory_order_relaxed);
+	}
+	slot.sequence.store(sequence + 2, std::memory_order_release);
+	return true;
+}
+
+} // namespace
@@ -0,0 +1,158 @@
+/*==============================================================================
+
+	OscState.h
+
+	lopack: an oscpack-inspired C++ wrapper for liblo
+
+	Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================*/
+#pragma once
+
+#include "OscTypes.h"
+#include <atomic>
+#include <mutex>
+
+namespace osc {
+
+/// max number of values kept per address, further arguments are dropped
+#define LOPACK_STATE_MAX_VALUES 8
+
+/// \class StateValue
+/// \brief a consistent copy of the latest values for an address
+///
+/// numeric values convert between types, ie. an int32 may be read with
+/// asFloat(); strings, symbols & blobs are not kept, only their type tags
+struct StateValue {
+	uint64_t updates;       ///< number of updates, 0 if never set
+	TimeTag arrival;        ///< arrival time of the latest message
+	unsigned int numValues; ///< number of values
+	char types[LOPACK_STATE_MAX_VALUES+1]; ///< type tags, NULL terminated
+	uint64_t bits[LOPACK_STATE_MAX_VALUES]; ///< raw value bits by index
+
+	StateValue() : updates(0), arrival(0, 0), numValues(0), types(), bits() {}
+
+	/// has a message been received for the address?
+	inline bool isSet() const {return updates > 0;}
+
+	/// get the type tag of a given value index, throws an ArgException if
+	/// the index is out of range
+	char typeTag(unsigned int at) const;
+
+	/// is the value numeric, ie. bool, char, int32, int64, float, or double?
+	bool isNumber(unsigned int at) const;
+
+	/// get a numeric value converted to the given type, throws an
+	/// ArgException if the index is out of range or a TypeException if the
+	/// value is not numeric
+	bool asBool(unsigned int at) const;
+	int32_t asInt32(unsigned int at) const;
+	int64_t asInt64(unsigned int at) const;
+	float asFloat(unsigned int at) const;
+	double asDouble(unsigned int at) const;
+
+	/// get a time tag value, throws an ArgException if the index is out of
+	/// range or a TypeException if the value is not a time tag
+	TimeTag asTimeTag(unsigned int at) const;
+};
+
+/// \class StateStore
+/// \brief latest message values per address, readable from any thread
+///
+/// addresses are registered up front & each gets a slot in a flat array of
+/// cache line aligned slots; when set on an OscReceiver, see
+/// OscReceiver::setStateStore(), each received message for a registered
+/// address overwrites its slot's values before dispatch, indexed by the
+/// message's interned address id, see AddressTable
+///
+/// each slot is a seqlock: the writer bumps the slot's sequence to odd,
+/// stores the values, & bumps it back to even, readers copy the values &
+/// retry if the sequence changed, so reads never lock or block the receive
+/// thread, ie. from audio or render threads
+class StateStore {
+
+	public:
+
+		/// constructor with the max number of addresses
+		StateStore(unsigned int capacity=256);
+		virtual ~StateStore();
+
+	/// \section Registration
+
+		/// register an address, returns the slot index for reading or -1
+		/// if the store is full or the address cannot be interned,
+		/// registering an address twice returns the same index
+		///
+		/// note: registering is thread safe but slots are never removed
+		int add(std::string_view address);
+
+		/// get the slot index for an address, -1 if not registered
+		int find(std::string_view address) const;
+
+		/// get the address of a slot index, empty if out of range
+		std::string_view getAddress(int index) const;
+
+		/// get the number of registered addresses
+		inline unsigned int size() const {return m_size.load(std::memory_order_acquire);}
+
+		/// get the max number of addresses
+		inline unsigned int getCapacity() const {return m_capacity;}
+
+	/// \section Reading
+
+		/// copy the latest values of a slot, returns false if the index is
+		/// out of range
+		bool read(int index, StateValue &value) const;
+
+		/// copy the latest values of an address, returns false if the
+		/// address is not registered
+		bool read(std::string_view address, StateValue &value) const;
+
+		/// get the number of updates to a slot without copying its values,
+		/// ie. to check for changes, returns 0 if the index is out of range
+		uint64_t getUpdates(int index) const;
+
+	/// \section Writing
+
+		/// store a message's values if its address is registered, returns
+		/// true if stored; called by OscReceiver
+		bool update(const ReceivedMessage &message);
+
+	private:
+
+		StateStore(StateStore const&);              // not copyable
+		StateStore& operator = (StateStore const&); // not assignable
+
+		/// an address's latest values, the data is stored in atomic words
+		/// so readers may copy while the writer stores
+		struct alignas(64) Slot {
+			std::atomic<uint64_t> sequence;  ///< odd while being written, 2x updates
+			std::atomic<uint64_t> arrival;   ///< packed arrival time tag
+			std::atomic<uint64_t> types;     ///< up to 8 packed type tags
+			std::atomic<uint32_t> numValues; ///< number of values
+			AddressId id;                    ///< interned address, set on add
+			std::atomic<uint64_t> bits[LOPACK_STATE_MAX_VALUES]; ///< raw value bits
+		};
+
+		Slot *m_slots;             ///< slot array
+		unsigned int m_capacity;   ///< number of slots
+		std::atomic<unsigned int> m_size; ///< number of registered slots
+		std::atomic<int32_t> *m_index; ///< slot index by address id, -1 if none
+		AddressId m_maxId;         ///< max address id
+		std::mutex m_mutex;        ///< serializes registration
+};
+
+} // namespace
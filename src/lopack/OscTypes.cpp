@@ -24,8 +24,19 @@
 
 #include <iostream>
 #include <exception>
+#include <stdlib.h>
+#include <string.h>
 #include <lo/lo.h>
 
+#ifdef WIN32
+	#include <winsock2.h>
+	#include <ws2tcpip.h>
+#else
+	#include <arpa/inet.h>
+	#include <netinet/in.h>
+	#include <sys/socket.h>
+#endif
+
 namespace osc {
 
 // TIME TAG
@@ -40,7 +51,7 @@ TimeTag::TimeTag(unsigned int ms) {
 }
 
 TimeTag::TimeTag(lo_timetag timetag) {
-	tag = tag;
+	tag = timetag;
 }
 
 bool TimeTag::operator==(const TimeTag &tag) const {
@@ -55,6 +66,11 @@ void TimeTag::now() {
 	lo_timetag_now(&tag);
 }
 
+void TimeTag::setUnixTime(uint64_t unixSec, uint32_t nsec) {
+	sec = (uint32_t)(unixSec + 2208988800ULL); // seconds from 1900 to 1970
+	frac = (uint32_t)(((uint64_t) nsec << 32) / 1000000000); // 1/2^32nds of a second
+}
+
 void TimeTag::add(unsigned int ms) {
 	tag.sec += ms / 1000; // seconds
 	tag.frac += ((ms%1000)*0.001) / 0.00000000023283064365; // 1/2^32nds of a second
@@ -72,17 +88,84 @@ double TimeTag::diff(const TimeTag &tag) const {
 
 // RECEIVED MESSAGE
 
-ReceivedMessage::ReceivedMessage(std::string addressPattern, lo_message message) :
-	m_addressPattern(addressPattern), m_message(message) {
+ReceivedMessage::ReceivedMessage(std::string_view addressPattern, lo_message message) :
+	m_addressPattern(addressPattern), m_addressId(AddressTable::find(addressPattern)),
+	m_message(message), m_kernelTimestamp(false) {
+	viewAddress();
+	lo_message_incref(m_message); // increment reference count
+}
+
+ReceivedMessage::ReceivedMessage(std::string_view addressPattern, lo_message message,
+                                 const TimeTag &arrival, bool kernelTimestamp) :
+	m_addressPattern(addressPattern), m_addressId(AddressTable::find(addressPattern)),
+	m_message(message), m_arrival(arrival), m_kernelTimestamp(kernelTimestamp) {
+	viewAddress();
 	lo_message_incref(m_message); // increment reference count
 }
 
-const bool ReceivedMessage::checkAddressAndTypes(std::string address, std::string types) const {
-	return (address == m_addressPattern && types == this->types());
+ReceivedMessage::ReceivedMessage(const ReceivedMessage &from) :
+	m_addressPattern(from.m_addressPattern), m_addressId(from.m_addressId), m_message(from.m_message),
+	m_arrival(from.m_arrival), m_kernelTimestamp(from.m_kernelTimestamp) {
+	if(!m_addressId) { // interned addresses are stable, copy the rest
+		m_ownedAddress.assign(from.m_addressPattern);
+		m_addressPattern = m_ownedAddress;
+	}
+	lo_message_incref(m_message);
+}
+
+ReceivedMessage::ReceivedMessage(const ReceivedMessage &from, lo_message message) :
+	m_addressPattern(from.m_addressPattern), m_addressId(from.m_addressId), m_message(message),
+	m_arrival(from.m_arrival), m_kernelTimestamp(from.m_kernelTimestamp) {
+	if(!m_addressId) {
+		m_ownedAddress.assign(from.m_addressPattern);
+		m_addressPattern = m_ownedAddress;
+	}
+	lo_message_incref(m_message);
+}
+
+ReceivedMessage& ReceivedMessage::operator=(const ReceivedMessage &from) {
+	if(this != &from) {
+		lo_message_incref(from.m_message);
+		lo_message_free(m_message); // decrement reference count
+		if(from.m_addressId) {
+			m_addressPattern = from.m_addressPattern;
+		}
+		else {
+			m_ownedAddress.assign(from.m_addressPattern);
+			m_addressPattern = m_ownedAddress;
+		}
+		m_addressId = from.m_addressId;
+		m_message = from.m_message;
+		m_arrival = from.m_arrival;
+		m_kernelTimestamp = from.m_kernelTimestamp;
+	}
+	return *this;
+}
+
+ReceivedMessage::~ReceivedMessage() {
+	lo_message_free(m_message); // decrement reference count
+}
+
+ReceivedMessage ReceivedMessage::clone() const {
+	return ReceivedMessage(*this, lo_message_clone(m_message));
+}
+
+void ReceivedMessage::viewAddress() {
+	if(m_addressId) { // view the stable interned copy
+		m_addressPattern = AddressTable::address(m_addressId);
+	}
+	else { // too long or the table is full, keep a copy
+		m_ownedAddress.assign(m_addressPattern);
+		m_addressPattern = m_ownedAddress;
+	}
+}
+
+const bool ReceivedMessage::checkAddressAndTypes(std::string_view address, std::string_view types) const {
+	return (address == m_addressPattern && types == lo_message_get_types(m_message));
 }
 
 const std::string ReceivedMessage::address() const {
-	return m_addressPattern;
+	return std::string(m_addressPattern);
 }
 
 const std::string ReceivedMessage::types() const {
@@ -90,7 +173,8 @@ const std::string ReceivedMessage::types() const {
 }
 
 const char ReceivedMessage::typeTag(unsigned int at) const {
-	return (at < numArgs()) ? types()[at] : '*';
+	// read liblo's type string directly, no std::string copy per argument
+	return (at < numArgs()) ? lo_message_get_types(m_message)[at] : '*';
 }
 
 const unsigned int ReceivedMessage::numArgs() const {
@@ -101,6 +185,30 @@ const TimeTag ReceivedMessage::getTimeTag() const {
 	return TimeTag(lo_message_get_timestamp(m_message));
 }
 
+const TimeTag ReceivedMessage::getArrivalTime() const {
+	return m_arrival;
+}
+
+const bool ReceivedMessage::hasKernelArrivalTime() const {
+	return m_kernelTimestamp;
+}
+
+const double ReceivedMessage::sendToArrivalLatency() const {
+	TimeTag sent = getTimeTag();
+	if(sent.isImmediate()) {
+		return 0;
+	}
+	return m_arrival - sent;
+}
+
+const double ReceivedMessage::sendToArrivalLatency(const TimeTag &sent) const {
+	return m_arrival - sent;
+}
+
+const double ReceivedMessage::arrivalToDispatchLatency() const {
+	return m_arrival.diff();
+}
+
 const bool ReceivedMessage::isBool(unsigned int at) const {return typeTag(at) == 'T' || typeTag(at) == 'F';}
 const bool ReceivedMessage::isChar(unsigned int at) const {return typeTag(at) == 'c';}
 const bool ReceivedMessage::isNil(unsigned int at) const {return typeTag(at) == 'N';}
@@ -344,6 +452,61 @@ const bool ReceivedMessage::tryString(std::string *dest, unsigned int at) const
 	return false;
 }
 
+// BULK READ ARGUMENTS
+
+void ReceivedMessage::readInt32s(unsigned int first, unsigned int count, int32_t *dest) const {
+	readRun('i', sizeof(int32_t), first, count, dest);
+}
+
+void ReceivedMessage::readInt64s(unsigned int first, unsigned int count, int64_t *dest) const {
+	readRun('h', sizeof(int64_t), first, count, dest);
+}
+
+void ReceivedMessage::readFloats(unsigned int first, unsigned int count, float *dest) const {
+	readRun('f', sizeof(float), first, count, dest);
+}
+
+void ReceivedMessage::readDoubles(unsigned int first, unsigned int count, double *dest) const {
+	readRun('d', sizeof(double), first, count, dest);
+}
+
+// ARRAYS
+
+unsigned int ReceivedMessage::runLength(unsigned int first) const {
+	unsigned int argc = numArgs();
+	if(first >= argc) {
+		throw ArgException();
+	}
+	const char *types = lo_message_get_types(m_message);
+	unsigned int end = first + 1;
+	while(end < argc && types[end] == types[first]) {
+		end++;
+	}
+	return end - first;
+}
+
+ArgSpan<int32_t> ReceivedMessage::int32Span(unsigned int first, unsigned int count) const {
+	const void *data = spanRun('i', sizeof(int32_t), first, count);
+	return ArgSpan<int32_t>((const int32_t *) data, count);
+}
+
+ArgSpan<int64_t> ReceivedMessage::int64Span(unsigned int first, unsigned int count) const {
+	const void *data = spanRun('h', sizeof(int64_t), first, count);
+	return ArgSpan<int64_t>((const int64_t *) data, count);
+}
+
+ArgSpan<float> ReceivedMessage::floatSpan(unsigned int first, unsigned int count) const {
+	const void *data = spanRun('f', sizeof(float), first, count);
+	return ArgSpan<float>((const float *) data, count);
+}
+
+ArgSpan<double> ReceivedMessage::doubleSpan(unsigned int first, unsigned int count) const {
+	const void *data = spanRun('d', sizeof(double), first, count);
+	return ArgSpan<double>((const double *) data, count);
+}
+
+// UTIL
+
 const lo_arg* ReceivedMessage::arg(unsigned int at) const {
 	if(at < numArgs()) {
 		lo_arg **argv = lo_message_get_argv(m_message);
@@ -369,16 +532,356 @@ const void ReceivedMessage::printAllArgs() const {
 	}
 }
 
+// PRIVATE
+
+void ReceivedMessage::checkRun(char type, unsigned int first, unsigned int count) const {
+	unsigned int argc = numArgs();
+	if(first >= argc || count > argc - first) {
+		throw ArgException();
+	}
+	const char *types = lo_message_get_types(m_message);
+	for(unsigned int i = first; i < first + count; ++i) {
+		if(types[i] != type) {
+			throw TypeException();
+		}
+	}
+}
+
+void ReceivedMessage::readRun(char type, size_t size, unsigned int first,
+                              unsigned int count, void *dest) const {
+	if(count == 0) {
+		return;
+	}
+	checkRun(type, first, count);
+
+	// a run of fixed size arguments is packed back to back in liblo's
+	// argument data, so copy it in one go when the layout allows
+	lo_arg **argv = lo_message_get_argv(m_message);
+	const char *start = (const char *) argv[first];
+	if((const char *) argv[first + count - 1] == start + (count - 1) * size) {
+		memcpy(dest, start, count * size);
+	}
+	else {
+		for(unsigned int i = 0; i < count; ++i) {
+			memcpy((char *) dest + i * size, argv[first + i], size);
+		}
+	}
+}
+
+const void* ReceivedMessage::spanRun(char type, size_t size, unsigned int first,
+                                     unsigned int &count) const {
+	if(count == 0) {
+		count = runLength(first);
+	}
+	checkRun(type, first, count);
+	lo_arg **argv = lo_message_get_argv(m_message);
+	const char *start = (const char *) argv[first];
+	if((const char *) argv[first + count - 1] != start + (count - 1) * size) {
+		throw TypeException("arguments are not contiguous");
+	}
+	if((uintptr_t) start % size != 0) { // 8 byte types are only 4 byte aligned in OSC
+		throw TypeException("arguments are not aligned, use a bulk read instead");
+	}
+	return start;
+}
+
+// MESSAGE ENCODER
+
+void MessageEncoder::begin(std::string_view addressPattern) {
+	m_address.clear();
+	appendString(m_address, addressPattern);
+	m_types.assign(1, ',');
+	m_args.clear();
+	m_dirty = true;
+}
+
+void MessageEncoder::add(bool var) {
+	m_types += var ? LO_TRUE : LO_FALSE;
+	m_dirty = true;
+}
+
+void MessageEncoder::add(char var) {
+	m_types += LO_CHAR;
+	append32((unsigned char) var);
+}
+
+void MessageEncoder::add(const Nil &var) {
+	m_types += LO_NIL;
+	m_dirty = true;
+}
+
+void MessageEncoder::add(const Infinitum &var) {
+	m_types += LO_INFINITUM;
+	m_dirty = true;
+}
+
+void MessageEncoder::add(int32_t var) {
+	m_types += LO_INT32;
+	append32((uint32_t) var);
+}
+
+void MessageEncoder::add(int64_t var) {
+	m_types += LO_INT64;
+	append64((uint64_t) var);
+}
+
+void MessageEncoder::add(float var) {
+	uint32_t bits;
+	memcpy(&bits, &var, sizeof(bits));
+	m_types += LO_FLOAT;
+	append32(bits);
+}
+
+void MessageEncoder::add(double var) {
+	uint64_t bits;
+	memcpy(&bits, &var, sizeof(bits));
+	m_types += LO_DOUBLE;
+	append64(bits);
+}
+
+void MessageEncoder::add(const char *var) {
+	add(std::string_view(var));
+}
+
+void MessageEncoder::add(const std::string &var) {
+	add(std::string_view(var));
+}
+
+void MessageEncoder::add(std::string_view var) {
+	m_types += LO_STRING;
+	appendString(m_args, var);
+	m_dirty = true;
+}
+
+void MessageEncoder::add(const Symbol &var) {
+	m_types += LO_SYMBOL;
+	appendString(m_args, var.value ? var.value : "");
+	m_dirty = true;
+}
+
+void MessageEncoder::add(const MidiMessage &var) {
+	m_types += LO_MIDI;
+	append(var.bytes, 4); // raw bytes, as liblo sends them
+}
+
+void MessageEncoder::add(const TimeTag &var) {
+	m_types += LO_TIMETAG;
+	append32(var.sec);
+	append32(var.frac);
+}
+
+void MessageEncoder::add(const Blob &var) {
+	static const char padding[4] = {0, 0, 0, 0};
+	m_types += LO_BLOB;
+	append32(var.size);
+	append(var.data, var.size);
+	append(padding, (4 - var.size % 4) % 4);
+}
+
+const char* MessageEncoder::data() {
+	if(m_dirty) {
+		m_message.assign(m_address.begin(), m_address.end());
+		appendString(m_message, m_types);
+		m_message.insert(m_message.end(), m_args.begin(), m_args.end());
+		m_dirty = false;
+	}
+	return m_message.data();
+}
+
+size_t MessageEncoder::size() {
+	data();
+	return m_message.size();
+}
+
+MessageEncoder& MessageEncoder::local() {
+	static thread_local MessageEncoder encoder;
+	return encoder;
+}
+
+// PRIVATE
+
+void MessageEncoder::append(const void *bytes, size_t size) {
+	const char *b = (const char *) bytes;
+	m_args.insert(m_args.end(), b, b + size);
+	m_dirty = true;
+}
+
+void MessageEncoder::append32(uint32_t var) {
+	char bytes[4] = {(char) (var >> 24), (char) (var >> 16), (char) (var >> 8), (char) var};
+	append(bytes, 4);
+}
+
+void MessageEncoder::append64(uint64_t var) {
+	append32((uint32_t) (var >> 32));
+	append32((uint32_t) var);
+}
+
+void MessageEncoder::appendString(std::vector<char> &buffer, std::string_view var) {
+	buffer.insert(buffer.end(), var.begin(), var.end());
+	buffer.resize(buffer.size() + 4 - var.size() % 4, '\0'); // at least one terminator
+}
+
 // MESSAGE SOURCE
 
-MessageSource::MessageSource(lo_address address) : m_address(address) {}
-		
-const std::string MessageSource::getHostname() const {return lo_address_get_hostname(m_address);}
-const std::string MessageSource::getPort() const {return lo_address_get_port(m_address);}
-const std::string MessageSource::getUrl() const {return	lo_address_get_url(m_address);}
+MessageSource::MessageSource(lo_address address, int socket) :
+	m_address(address), m_owned(false), m_socket(socket), m_sockaddrSize(0) {}
+
+MessageSource::MessageSource(const struct sockaddr *sockaddr, unsigned int size, int socket) :
+	m_address(NULL), m_owned(false), m_socket(socket), m_sockaddrSize(0) {
+	if(size <= sizeof(m_sockaddr)) {
+		memcpy(m_sockaddr, sockaddr, size);
+		m_sockaddrSize = size;
+	}
+}
+
+MessageSource::MessageSource(const MessageSource &from) :
+	m_address(NULL), m_owned(false), m_socket(from.m_socket), m_sockaddrSize(0) {
+	*this = from;
+}
+
+MessageSource& MessageSource::operator=(const MessageSource &from) {
+	if(this != &from) {
+		// the binary address is enough, the liblo address is made on demand
+		lo_address address = from.parseAddress() ? NULL : copyAddress(from.m_address);
+		if(m_owned && m_address) {
+			lo_address_free(m_address);
+		}
+		m_address = address;
+		m_owned = (address != NULL);
+		m_socket = from.m_socket;
+		m_sockaddrSize = from.m_sockaddrSize;
+		memcpy(m_sockaddr, from.m_sockaddr, m_sockaddrSize);
+	}
+	return *this;
+}
+
+MessageSource::~MessageSource() {
+	if(m_owned && m_address) {
+		lo_address_free(m_address);
+	}
+}
+
+const std::string MessageSource::getHostname() const {
+	if(m_sockaddrSize == 0) {
+		const char *host = m_address ? lo_address_get_hostname(m_address) : NULL;
+		return host ? host : ""; // unknown for scheduled bundles
+	}
+	char host[INET6_ADDRSTRLEN];
+	if(((const struct sockaddr *) m_sockaddr)->sa_family == AF_INET) {
+		const struct sockaddr_in *v4 = (const struct sockaddr_in *) m_sockaddr;
+		inet_ntop(AF_INET, (void *) &v4->sin_addr, host, sizeof(host));
+	}
+	else {
+		const struct sockaddr_in6 *v6 = (const struct sockaddr_in6 *) m_sockaddr;
+		inet_ntop(AF_INET6, (void *) &v6->sin6_addr, host, sizeof(host));
+	}
+	return host;
+}
+
+const std::string MessageSource::getPort() const {
+	if(m_sockaddrSize == 0) {
+		const char *port = m_address ? lo_address_get_port(m_address) : NULL;
+		return port ? port : "";
+	}
+	return std::to_string(getKey().port);
+}
+
+const std::string MessageSource::getUrl() const {
+	lo_address address = getAddress();
+	char *url = address ? lo_address_get_url(address) : NULL;
+	std::string ret = url ? url : "";
+	free(url); // allocated by liblo
+	return ret;
+}
+
+const lo_address MessageSource::getAddress() const {
+	if(!m_address && m_sockaddrSize > 0) {
+		m_address = lo_address_new_with_proto(LO_UDP, getHostname().c_str(),
+		                                      getPort().c_str());
+		m_owned = true;
+	}
+	return m_address;
+}
+
+bool MessageSource::reply(MessageEncoder &encoder) const {
+	if(m_socket < 0 || !parseAddress()) {
+		return false;
+	}
+	size_t size = encoder.size();
+	return sendto(m_socket, encoder.data(), size, 0,
+	              (const struct sockaddr *) m_sockaddr, m_sockaddrSize) == (int) size;
+}
+
+SourceKey MessageSource::getKey() const {
+	SourceKey key;
+	if(!parseAddress()) {
+		return key;
+	}
+	if(((const struct sockaddr *) m_sockaddr)->sa_family == AF_INET) {
+		const struct sockaddr_in *v4 = (const struct sockaddr_in *) m_sockaddr;
+		key.family = 4;
+		key.port = ntohs(v4->sin_port);
+		memcpy(key.address, &v4->sin_addr, 4);
+	}
+	else {
+		const struct sockaddr_in6 *v6 = (const struct sockaddr_in6 *) m_sockaddr;
+		key.family = 6;
+		key.port = ntohs(v6->sin6_port);
+		memcpy(key.address, &v6->sin6_addr, 16);
+	}
+	return key;
+}
+
+bool MessageSource::canReply() const {
+	return m_socket >= 0 && parseAddress();
+}
 
 const void MessageSource::print() const {
 	std::cout << getHostname() << " " << getPort() << std::endl;
 }
 
+bool MessageSource::parseAddress() const {
+	if(m_sockaddrSize > 0) {
+		return true;
+	}
+	if(!m_address) {
+		return false;
+	}
+	// liblo keeps the source host & port as numeric strings
+	const char *host = lo_address_get_hostname(m_address);
+	const char *port = lo_address_get_port(m_address);
+	if(!host || !port) {
+		return false;
+	}
+	uint16_t p = htons((uint16_t) atoi(port));
+	struct sockaddr_in v4;
+	memset(&v4, 0, sizeof(v4));
+	if(inet_pton(AF_INET, host, &v4.sin_addr) == 1) {
+		v4.sin_family = AF_INET;
+		v4.sin_port = p;
+		memcpy(m_sockaddr, &v4, sizeof(v4));
+		m_sockaddrSize = sizeof(v4);
+		return true;
+	}
+	struct sockaddr_in6 v6;
+	memset(&v6, 0, sizeof(v6));
+	if(inet_pton(AF_INET6, host, &v6.sin6_addr) == 1) {
+		v6.sin6_family = AF_INET6;
+		v6.sin6_port = p;
+		memcpy(m_sockaddr, &v6, sizeof(v6));
+		m_sockaddrSize = sizeof(v6);
+		return true;
+	}
+	return false;
+}
+
+lo_address MessageSource::copyAddress(lo_address address) {
+	if(!address || !lo_address_get_hostname(address)) {
+		return NULL;
+	}
+	return lo_address_new_with_proto(lo_address_get_protocol(address),
+	                                 lo_address_get_hostname(address),
+	                                 lo_address_get_port(address));
+}
+
 } // namespace
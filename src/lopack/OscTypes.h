@@ -29,10 +29,15 @@
 ==============================================================================*/
 #pragma once
 
+#include "OscIntern.h"
 #include <lo/lo.h>
 #include <string>
+#include <string_view>
 #include <math.h>
 #include <stdexcept>
+#include <vector>
+
+struct sockaddr;
 
 namespace osc {
 
@@ -108,6 +113,13 @@ struct TimeTag {
 	/// set the current time (not immediate)
 	void now();
 
+	/// set the time from a unix time (seconds since Jan 1 1970 UTC) and nanoseconds
+	void setUnixTime(uint64_t unixSec, uint32_t nsec);
+
+	/// returns true if this is the special "immediately" timetag used by
+	/// messages & bundles without a time
+	bool isImmediate() const {return sec == 0 && frac == 1;}
+
 	/// add the number of milliseconds to the current timestamp
 	void add(unsigned int ms);
 	
@@ -127,7 +139,7 @@ struct Symbol {
 	
 	/// constructors to set the string
 	explicit Symbol(const char *value_) : value(value_) {}
-	explicit Symbol(const std::string value_) : value(value_.c_str()) {}
+	explicit Symbol(const std::string &value_) : value(value_.c_str()) {}
 
 	operator const char*() const {return value;} ///< operator to grab the string implicitly
 };
@@ -144,6 +156,23 @@ struct Blob {
 	explicit Blob(const void *data_, uint32_t size_) : data(data_), size(size_) {}
 };
 
+/// a read only view of a contiguous run of same type arguments within a
+/// received message, only valid while the message exists
+template <class T> struct ArgSpan {
+	const T *data;     ///< pointer to the first value
+	unsigned int size; ///< number of values
+	
+	/// constructor
+	explicit ArgSpan() : data(NULL), size(0) {}
+	
+	/// constructor to set the data pointer and number of values
+	explicit ArgSpan(const T *data_, unsigned int size_) : data(data_), size(size_) {}
+	
+	inline const T* begin() const {return data;}
+	inline const T* end() const {return data + size;}
+	inline const T& operator[](unsigned int i) const {return data[i];}
+};
+
 /// \section Stream Manipulators
 
 /// start a message bundle
@@ -164,10 +193,21 @@ struct EndBundle {};
 /// start a message
 struct BeginMessage {
 
-	const std::string addressPattern; ///< the message address
+	const std::string owned;               ///< address storage for temporaries
+	const std::string_view addressPattern; ///< the message address
 
-	/// set the message target address
-	explicit BeginMessage(const std::string addressPattern_) : addressPattern(addressPattern_) {}
+	/// set the message target address, views the caller's address
+	explicit BeginMessage(std::string_view addressPattern_) : addressPattern(addressPattern_) {}
+	explicit BeginMessage(const char *addressPattern_) : addressPattern(addressPattern_) {}
+	explicit BeginMessage(const std::string &addressPattern_) : addressPattern(addressPattern_) {}
+
+	/// set the message target address from a temporary, which is kept
+	explicit BeginMessage(std::string &&addressPattern_) :
+		owned(std::move(addressPattern_)), addressPattern(owned) {}
+
+	/// copies view the copied storage if the address is kept
+	BeginMessage(const BeginMessage &from) : owned(from.owned),
+		addressPattern(from.owned.empty() ? from.addressPattern : std::string_view(owned)) {}
 };
 
 /// end a message
@@ -205,17 +245,51 @@ class ReceivedMessage {
 		/// osc address pattern 
 		/// message the liblo message
 		/// note: performs a *shallow copy* of the underlying liblo message
-		///       which is reference counted
-		ReceivedMessage(std::string addressPattern, lo_message message);
+		///       which is reference counted; the address pattern's id is
+		///       looked up if it was interned by a registration, ie. a
+		///       handler, see AddressTable, or the address is otherwise copied
+		ReceivedMessage(std::string_view addressPattern, lo_message message);
+
+		/// constructor with the arrival time of the message's datagram,
+		/// set kernelTimestamp if the time is from the kernel receive timestamp
+		ReceivedMessage(std::string_view addressPattern, lo_message message,
+		                const TimeTag &arrival, bool kernelTimestamp=false);
+
+		/// copy constructor, shares the underlying liblo message & keeps its
+		/// own copy of the address pattern if it is not interned
+		ReceivedMessage(const ReceivedMessage &from);
+
+		/// assignment operator, shares the underlying liblo message
+		ReceivedMessage& operator=(const ReceivedMessage &from);
+
+		/// releases the reference to the underlying liblo message
+		~ReceivedMessage();
+
+		/// get a copy with its own deep copy of the liblo message
+		///
+		/// note: liblo's reference count is not thread safe, so copies which
+		///       share a message must stay on one thread; hand a clone to
+		///       another thread, ie. when queueing for dispatch, so only that
+		///       thread references it
+		ReceivedMessage clone() const;
 	
 	/// \section Info
 	
 		/// returns true if the message matches the given address and argument type string
-		const bool checkAddressAndTypes(std::string addressPattern, std::string types) const;
+		const bool checkAddressAndTypes(std::string_view addressPattern, std::string_view types) const;
 		
 		/// get the message address pattern
 		const std::string address() const;
 		
+		/// get the message address pattern without copying
+		inline std::string_view addressView() const {return m_addressPattern;}
+
+		/// get the interned address pattern id, 0 if not interned,
+		/// compare with ids from AddressTable::intern(); received messages
+		/// only look up ids & never intern, so this is 0 for addresses
+		/// which were not registered
+		inline AddressId addressId() const {return m_addressId;}
+		
 		/// get the argument type string
 		const std::string types() const;
 		
@@ -227,6 +301,33 @@ class ReceivedMessage {
 	
 		/// get the message's time tag when received
 		const TimeTag getTimeTag() const;
+
+	/// \section Latency
+
+		/// get the time the message's datagram arrived
+		///
+		/// this is the kernel receive timestamp when enabled & available
+		/// (Linux), see OscReceiver::setKernelTimestamps(), otherwise the time
+		/// the receiver read the message's datagram
+		const TimeTag getArrivalTime() const;
+
+		/// returns true if the arrival time is a kernel receive timestamp
+		const bool hasKernelArrivalTime() const;
+
+		/// get the time between the sender's time tag & arrival in seconds,
+		/// requires the sender to stamp the bundle with the current time,
+		/// ie. BeginBundle(TimeTag()), returns 0 if the message has no time tag
+		///
+		/// note: only meaningful if the sender & receiver clocks are synced
+		const double sendToArrivalLatency() const;
+
+		/// get the time between a given send time & arrival in seconds,
+		/// for senders which send their time tag as a message argument
+		const double sendToArrivalLatency(const TimeTag &sent) const;
+
+		/// get the time between arrival & now in seconds, call from a message
+		/// handler to get the time spent queued within the receiving process
+		const double arrivalToDispatchLatency() const;
 	
 	/// \section Read Arguments
 		
@@ -279,6 +380,38 @@ class ReceivedMessage {
 		const bool tryNumber(double *dest, unsigned int at) const;
 		const bool tryString(std::string *dest, unsigned int at) const; // includes Symbol
 	
+	/// \section Bulk Read Arguments
+	
+		/// copy count arguments starting at index first into dest, the type
+		/// run is checked once, throws an exception on bad index or type
+		///
+		/// note: liblo converts arguments to host byte order on receive, so
+		///       runs are copied straight from the message
+		void readInt32s(unsigned int first, unsigned int count, int32_t *dest) const;
+		void readInt64s(unsigned int first, unsigned int count, int64_t *dest) const;
+		void readFloats(unsigned int first, unsigned int count, float *dest) const;
+		void readDoubles(unsigned int first, unsigned int count, double *dest) const;
+	
+	/// \section Arrays
+	///
+	/// liblo does not support the OSC 1.1 array type tags '[' & ']', so
+	/// arrays are sent flattened & read as runs of same type arguments;
+	/// adjacent runs of the same type merge, so senders separate them with
+	/// another argument, ie. a leading length
+	
+		/// get the number of consecutive arguments with the same type starting
+		/// at an index, use to step through a message run by run
+		/// throws an exception on bad index
+		unsigned int runLength(unsigned int first) const;
+	
+		/// get a view of count arguments starting at index first without
+		/// copying, count 0 takes the rest of the run; throws an exception on
+		/// bad index or type or if the argument data is not aligned for T
+		ArgSpan<int32_t> int32Span(unsigned int first, unsigned int count=0) const;
+		ArgSpan<int64_t> int64Span(unsigned int first, unsigned int count=0) const;
+		ArgSpan<float> floatSpan(unsigned int first, unsigned int count=0) const;
+		ArgSpan<double> doubleSpan(unsigned int first, unsigned int count=0) const;
+	
 	/// \section Util
 	
 		/// get the raw liblo argument at a given index
@@ -298,9 +431,142 @@ class ReceivedMessage {
 		inline const lo_message message() const {return m_message;}
 		
 	private:
+
+		/// copy constructor taking a reference to another liblo message
+		ReceivedMessage(const ReceivedMessage &from, lo_message message);
+	
+		/// view the interned address or copy it if it is not interned
+		void viewAddress();
+	
+		/// check a run of arguments of the given type, throws on bad index or type
+		void checkRun(char type, unsigned int first, unsigned int count) const;
 	
-		std::string m_addressPattern; ///< osc message address pattern
+		/// check & copy a run of fixed size arguments of the given type
+		void readRun(char type, size_t size, unsigned int first,
+		             unsigned int count, void *dest) const;
+	
+		/// check a run of fixed size arguments & get a pointer to the first,
+		/// count 0 is set to the rest of the run
+		const void* spanRun(char type, size_t size, unsigned int first,
+		                    unsigned int &count) const;
+	
+		std::string m_ownedAddress;         ///< address pattern storage for copies
+		std::string_view m_addressPattern; ///< osc message address pattern
+		AddressId m_addressId; ///< interned address pattern id, 0 if not interned
 		lo_message  m_message; ///< liblo message
+		TimeTag m_arrival; ///< datagram arrival time
+		bool m_kernelTimestamp; ///< is m_arrival from the kernel?
+};
+
+/// \class MessageEncoder
+/// \brief encodes an osc message into a reused buffer
+///
+/// writes the OSC binary format directly instead of building a liblo
+/// message, the buffers grow to the largest message & are kept, so encoding
+/// does not allocate once warmed up:
+///
+///   encoder.begin("/reply/voices");
+///   encoder.add(16);
+///   encoder.add("poly");
+///   send(encoder.data(), encoder.size());
+class MessageEncoder {
+
+	public:
+
+		MessageEncoder() : m_dirty(true) {}
+
+		/// clear & start a message with the given address pattern
+		void begin(std::string_view addressPattern);
+
+		/// encode a whole message
+		template <class... Args>
+		void encode(std::string_view addressPattern, const Args&... args) {
+			begin(addressPattern);
+			(add(args), ...);
+		}
+
+		void add(bool var);
+		void add(char var);
+		void add(const Nil &var);
+		void add(const Infinitum &var);
+
+		void add(int32_t var);
+		void add(int64_t var);
+
+		void add(float var);
+		void add(double var);
+
+		void add(const char *var);
+		void add(const std::string &var);
+		void add(std::string_view var);
+		void add(const Symbol &var);
+
+		void add(const MidiMessage &var);
+		void add(const TimeTag &var);
+		void add(const Blob &var);
+
+		/// get the encoded message, valid until the next begin() or add()
+		const char* data();
+
+		/// get the encoded message size in bytes
+		size_t size();
+
+		/// get the calling thread's encoder
+		static MessageEncoder& local();
+
+	private:
+
+		MessageEncoder(MessageEncoder const&);              // not copyable
+		MessageEncoder& operator = (MessageEncoder const&); // not assignable
+
+		/// append bytes to the arguments
+		void append(const void *bytes, size_t size);
+
+		/// append a 32 or 64 bit value in big endian byte order
+		void append32(uint32_t var);
+		void append64(uint64_t var);
+
+		/// append a null terminated string padded to 4 bytes
+		void appendString(std::vector<char> &buffer, std::string_view var);
+
+		std::vector<char> m_address;  ///< padded address pattern
+		std::string m_types;          ///< type tag string
+		std::vector<char> m_args;     ///< encoded arguments
+		std::vector<char> m_message;  ///< assembled message
+		bool m_dirty;                 ///< does m_message need assembling?
+};
+
+/// a compact binary key for a message source's socket address, for hashing
+/// & comparing sources without string work
+struct SourceKey {
+	uint8_t family;      ///< 4 for IPv4, 6 for IPv6, 0 if unknown
+	uint16_t port;       ///< port in host byte order
+	uint8_t address[16]; ///< IPv4 uses the first 4 bytes, the rest are 0
+
+	/// constructor, unknown source
+	SourceKey() : family(0), port(0), address() {}
+
+	bool operator==(const SourceKey &key) const {
+		if(family != key.family || port != key.port) {
+			return false;
+		}
+		for(unsigned int i = 0; i < 16; ++i) {
+			if(address[i] != key.address[i]) {
+				return false;
+			}
+		}
+		return true;
+	}
+	bool operator!=(const SourceKey &key) const {return !(*this == key);}
+
+	/// hash functor for unordered containers
+	struct Hash {
+		size_t operator()(const SourceKey &key) const {
+			uint64_t hash = hashBytes(&key.family, sizeof(key.family));
+			hash = hashBytes(&key.port, sizeof(key.port), hash);
+			return (size_t) hashBytes(key.address, sizeof(key.address), hash);
+		}
+	};
 };
 
 /// \class MessageSource
@@ -311,18 +577,77 @@ class MessageSource {
 	
 		/// constructor:
 		/// address liblo address to wrap
-		MessageSource(lo_address address);
+		/// socket the receiving server's socket for replies, -1 if none
+		MessageSource(lo_address address, int socket=-1);
+
+		/// constructor from a binary socket address, ie. from recvmsg(), the
+		/// liblo address is only made if getAddress() or getUrl() is called
+		/// sockaddr sockaddr_in or sockaddr_in6, copied
+		/// size socket address size
+		/// socket the receiving server's socket for replies, -1 if none
+		MessageSource(const struct sockaddr *sockaddr, unsigned int size, int socket=-1);
+
+		/// copies keep the binary socket address, or own a new liblo address
+		/// if there is none, so they remain valid after the receive callback
+		/// returns, ie. when queueing messages
+		MessageSource(const MessageSource &from);
+		MessageSource& operator=(const MessageSource &from);
+		~MessageSource();
 		
-		const std::string getHostname() const; ///< get the hostname
+		const std::string getHostname() const; ///< get the numeric hostname
 		const std::string getPort() const;     ///< get the port
 		const std::string getUrl() const;      ///< get the url of the host
 	
+		/// get the underlying liblo address, made from the binary socket
+		/// address on first call if there is one
+		const lo_address getAddress() const;
+		
+		/// get the binary key for the source's socket address, family is 0
+		/// if unknown; no string work unless the source only has a liblo
+		/// address, which is then parsed once & cached
+		SourceKey getKey() const;
+	
+	/// \section Replying
+	///
+	/// replies are sent from the receiving server's socket straight to the
+	/// source's binary socket address, as received or parsed from the
+	/// numeric host once, & encoded with the calling thread's MessageEncoder,
+	/// so a reply needs no resolution, new socket, or allocation; the sender
+	/// sees the reply come from the port it sent to
+	///
+	/// note: the receiving server must still be set up when replying,
+	///       sources from replayed messages cannot reply
+	
+		/// encode & send a reply message, returns false on error
+		template <class... Args>
+		bool reply(std::string_view addressPattern, const Args&... args) const {
+			MessageEncoder &encoder = MessageEncoder::local();
+			encoder.encode(addressPattern, args...);
+			return reply(encoder);
+		}
+	
+		/// send an encoded reply message, returns false on error
+		bool reply(MessageEncoder &encoder) const;
+	
+		/// can this source be replied to?
+		bool canReply() const;
+	
 		/// print to std::cout
 		const void print() const;
 	
 	private:
 		
-		lo_address m_address; ///< liblo host address
+		/// make an owned copy of a liblo address, NULL if address is NULL
+		static lo_address copyAddress(lo_address address);
+		
+		/// parse & cache the binary socket address, returns false on error
+		bool parseAddress() const;
+		
+		mutable lo_address m_address; ///< liblo host address, NULL until made
+		mutable bool m_owned;         ///< free the address when destroyed?
+		int m_socket;         ///< receiving server socket, -1 if none
+		mutable unsigned char m_sockaddr[28]; ///< cached socket address, large enough for IPv6
+		mutable unsigned int m_sockaddrSize;  ///< cached socket address size, 0 if not parsed
 };
 
 } // namespace
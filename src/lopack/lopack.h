@@ -22,6 +22,9 @@
 ==============================================================================*/
 #pragma once
 
+#include "OscClock.h"
+#include "OscLog.h"
 #include "OscObject.h"
 #include "OscReceiver.h"
+#include "OscRpc.h"
 #include "OscSender.h"
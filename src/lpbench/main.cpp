@@ -0,0 +1,443 @@
+/*==============================================================================
+
+	main.cpp
+
+	lpbench: lopack benchmark program
+
+	Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================*/
+#include <lopack/lopack.h>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string.h>
+#include <stdlib.h>
+
+using namespace std;
+
+// options
+static unsigned int iterations = 100000; //< iterations per benchmark
+static unsigned int port = 9991;         //< loopback port
+static string filter = "";               //< only run matching benchmarks
+static bool json = false;                //< print JSON lines instead of CSV
+
+// sink to keep the compiler from optimizing out results
+static volatile double sink = 0;
+
+/// add a result to the sink, C++20 deprecates += on volatile
+static inline void consume(double value) {
+	sink = sink + value;
+}
+
+/// time a function over a number of iterations & print the result
+template <class Func>
+void bench(const string &name, unsigned int count, Func func) {
+	if(filter != "" && name.find(filter) == string::npos) {
+		return;
+	}
+	// warm up
+	for(unsigned int i = 0; i < count / 10 + 1; ++i) {
+		func(i);
+	}
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for(unsigned int i = 0; i < count; ++i) {
+		func(i);
+	}
+	chrono::steady_clock::time_point end = chrono::steady_clock::now();
+	double ns = chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+	double nsPerOp = ns / count;
+	double opsPerSec = nsPerOp > 0 ? 1000000000.0 / nsPerOp : 0;
+	if(json) {
+		cout << "{\"benchmark\":\"" << name << "\",\"iterations\":" << count
+		     << ",\"ns_per_op\":" << nsPerOp << ",\"ops_per_sec\":" << opsPerSec
+		     << "}" << endl;
+	}
+	else {
+		cout << name << "," << count << "," << nsPerOp << "," << opsPerSec << endl;
+	}
+}
+
+// ENCODE
+
+/// build a message with a single argument of each type, no sending
+void benchEncode() {
+	osc::OscSender sender;
+	osc::MidiMessage midi;
+	osc::TimeTag timetag;
+	const char blobData[16] = "0123456789abcde";
+	osc::Blob blob(blobData, sizeof(blobData));
+	string str = "a string";
+
+	bench("encode/empty", iterations, [&](unsigned int i) {
+		sender << osc::BeginMessage("/bench") << osc::EndMessage();
+		sender.clear();
+	});
+	bench("encode/bool", iterations, [&](unsigned int i) {
+		sender << osc::BeginMessage("/bench") << true << osc::EndMessage();
+		sender.clear();
+	});
+	bench("encode/char", iterations, [&](unsigned int i) {
+		sender << osc::BeginMessage("/bench") << 'c' << osc::EndMessage();
+		sender.clear();
+	});
+	bench("encode/nil", iterations, [&](unsigned int i) {
+		sender << osc::BeginMessage("/bench") << osc::Nil() << osc::EndMessage();
+		sender.clear();
+	});
+	bench("encode/infinitum", iterations, [&](unsigned int i) {
+		sender << osc::BeginMessage("/bench") << osc::Infinitum() << osc::EndMessage();
+		sender.clear();
+	});
+	bench("encode/int32", iterations, [&](unsigned int i) {
+		sender << osc::BeginMessage("/bench") << (int32_t) i << osc::EndMessage();
+		sender.clear();
+	});
+	bench("encode/int64", iterations, [&](unsigned int i) {
+		sender << osc::BeginMessage("/bench") << (int64_t) i << osc::EndMessage();
+		sender.clear();
+	});
+	bench("encode/float", iterations, [&](unsigned int i) {
+		sender << osc::BeginMessage("/bench") << (float) i << osc::EndMessage();
+		sender.clear();
+	});
+	bench("encode/double", iterations, [&](unsigned int i) {
+		sender << osc::BeginMessage("/bench") << (double) i << osc::EndMessage();
+		sender.clear();
+	});
+	bench("encode/string", iterations, [&](unsigned int i) {
+		sender << osc::BeginMessage("/bench") << str << osc::EndMessage();
+		sender.clear();
+	});
+	bench("encode/symbol", iterations, [&](unsigned int i) {
+		sender << osc::BeginMessage("/bench") << osc::Symbol("symbol") << osc::EndMessage();
+		sender.clear();
+	});
+	bench("encode/midi", iterations, [&](unsigned int i) {
+		sender << osc::BeginMessage("/bench") << midi << osc::EndMessage();
+		sender.clear();
+	});
+	bench("encode/timetag", iterations, [&](unsigned int i) {
+		sender << osc::BeginMessage("/bench") << timetag << osc::EndMessage();
+		sender.clear();
+	});
+	bench("encode/blob", iterations, [&](unsigned int i) {
+		sender << osc::BeginMessage("/bench") << blob << osc::EndMessage();
+		sender.clear();
+	});
+	bench("encode/float_x64", iterations / 10, [&](unsigned int i) {
+		sender << osc::BeginMessage("/bench");
+		for(unsigned int j = 0; j < 64; ++j) {
+			sender << (float) j;
+		}
+		sender << osc::EndMessage();
+		sender.clear();
+	});
+	float frame[512];
+	for(unsigned int j = 0; j < 512; ++j) {
+		frame[j] = j / 512.0f;
+	}
+	bench("encode/float_x512", iterations / 50, [&](unsigned int i) {
+		sender << osc::BeginMessage("/bench");
+		for(unsigned int j = 0; j < 512; ++j) {
+			sender << frame[j];
+		}
+		sender << osc::EndMessage();
+		sender.clear();
+	});
+	bench("encode/float_x512_bulk", iterations / 50, [&](unsigned int i) {
+		sender << osc::BeginMessage("/bench");
+		sender.addFloats(frame, 512);
+		sender << osc::EndMessage();
+		sender.clear();
+	});
+}
+
+/// build nested bundles with one message at each depth, no sending
+void benchBundles() {
+	osc::OscSender sender;
+	const unsigned int depths[] = {1, 2, 4, 8};
+	for(unsigned int d = 0; d < sizeof(depths)/sizeof(unsigned int); ++d) {
+		unsigned int depth = depths[d];
+		stringstream name;
+		name << "bundle/depth_" << depth;
+		bench(name.str(), iterations / depth, [&](unsigned int i) {
+			for(unsigned int j = 0; j < depth; ++j) {
+				sender << osc::BeginBundle()
+				       << osc::BeginMessage("/bench") << (int32_t) j << osc::EndMessage();
+			}
+			for(unsigned int j = 0; j < depth; ++j) {
+				sender << osc::EndBundle();
+			}
+			sender.clear();
+		});
+	}
+}
+
+// DECODE
+
+/// read a single argument of each type from a received message
+void benchDecode() {
+	lo_message m = lo_message_new();
+	lo_message_incref(m); // keep it alive past the ReceivedMessages
+	uint8_t midi[4] = {0x7F, 0x90, 0x3E, 0x60};
+	const char blobData[16] = "0123456789abcde";
+	lo_blob blob = lo_blob_new(sizeof(blobData), blobData);
+	lo_timetag timetag;
+	lo_timetag_now(&timetag);
+	lo_message_add_true(m);               // 0
+	lo_message_add_char(m, 'c');          // 1
+	lo_message_add_int32(m, 100);         // 2
+	lo_message_add_int64(m, 200);         // 3
+	lo_message_add_float(m, 1.5f);        // 4
+	lo_message_add_double(m, 2.5);        // 5
+	lo_message_add_string(m, "a string"); // 6
+	lo_message_add_symbol(m, "symbol");   // 7
+	lo_message_add_midi(m, midi);         // 8
+	lo_message_add_timetag(m, timetag);   // 9
+	lo_message_add_blob(m, blob);         // 10
+
+	// make sure argv is built before timing
+	lo_message_get_argv(m);
+
+	bench("decode/construct", iterations, [&](unsigned int i) {
+		osc::ReceivedMessage message("/bench", m);
+		consume(message.numArgs());
+	});
+	bench("decode/check_address_types", iterations, [&](unsigned int i) {
+		osc::ReceivedMessage message("/bench", m);
+		consume(message.checkAddressAndTypes("/bench", "TcihfdsSmtb"));
+	});
+	bench("decode/bool", iterations, [&](unsigned int i) {
+		osc::ReceivedMessage message("/bench", m);
+		consume(message.asBool(0));
+	});
+	bench("decode/char", iterations, [&](unsigned int i) {
+		osc::ReceivedMessage message("/bench", m);
+		consume(message.asChar(1));
+	});
+	bench("decode/int32", iterations, [&](unsigned int i) {
+		osc::ReceivedMessage message("/bench", m);
+		consume(message.asInt32(2));
+	});
+	bench("decode/int64", iterations, [&](unsigned int i) {
+		osc::ReceivedMessage message("/bench", m);
+		consume(message.asInt64(3));
+	});
+	bench("decode/float", iterations, [&](unsigned int i) {
+		osc::ReceivedMessage message("/bench", m);
+		consume(message.asFloat(4));
+	});
+	bench("decode/double", iterations, [&](unsigned int i) {
+		osc::ReceivedMessage message("/bench", m);
+		consume(message.asDouble(5));
+	});
+	bench("decode/string", iterations, [&](unsigned int i) {
+		osc::ReceivedMessage message("/bench", m);
+		consume(message.asString(6).size());
+	});
+	bench("decode/symbol", iterations, [&](unsigned int i) {
+		osc::ReceivedMessage message("/bench", m);
+		consume(message.asSymbol(7).value[0]);
+	});
+	bench("decode/midi", iterations, [&](unsigned int i) {
+		osc::ReceivedMessage message("/bench", m);
+		consume(message.asMidiMessage(8).value);
+	});
+	bench("decode/timetag", iterations, [&](unsigned int i) {
+		osc::ReceivedMessage message("/bench", m);
+		consume(message.asTimeTag(9).sec);
+	});
+	bench("decode/blob", iterations, [&](unsigned int i) {
+		osc::ReceivedMessage message("/bench", m);
+		consume(message.asBlob(10).size);
+	});
+	bench("decode/try_number", iterations, [&](unsigned int i) {
+		osc::ReceivedMessage message("/bench", m);
+		float f = 0;
+		message.tryNumber(&f, 2);
+		consume(f);
+	});
+
+
+	// 512 float frame
+	lo_message frame = lo_message_new();
+	lo_message_incref(frame); // keep it alive past the ReceivedMessages
+	for(unsigned int j = 0; j < 512; ++j) {
+		lo_message_add_float(frame, j / 512.0f);
+	}
+	lo_message_get_argv(frame);
+	float values[512];
+	bench("decode/float_x512", iterations / 50, [&](unsigned int i) {
+		osc::ReceivedMessage message("/bench", frame);
+		for(unsigned int j = 0; j < 512; ++j) {
+			values[j] = message.asFloat(j);
+		}
+		consume(values[511]);
+	});
+	bench("decode/float_x512_bulk", iterations / 50, [&](unsigned int i) {
+		osc::ReceivedMessage message("/bench", frame);
+		message.readFloats(0, 512, values);
+		consume(values[511]);
+	});
+	lo_message_free(frame);
+
+	lo_blob_free(blob);
+	lo_message_free(m);
+}
+
+// DISPATCH
+
+/// object which handles a single float message at its root address
+class BenchObject : public osc::OscObject {
+	public:
+		BenchObject(string rootAddress) : osc::OscObject(rootAddress) {}
+	protected:
+		bool processOscMessage(const osc::ReceivedMessage &message, const osc::MessageSource &source) {
+			if(message.checkAddressAndTypes(oscRootAddress, "f")) {
+				consume(message.asFloat(0));
+				return true;
+			}
+			return false;
+		}
+};
+
+/// dispatch through trees of objects, the last object added handles the
+/// message so every object is visited
+void benchDispatch() {
+	lo_message m = lo_message_new();
+	lo_message_incref(m); // keep it alive past the ReceivedMessages
+	lo_message_add_float(m, 1.5f);
+	lo_address address = lo_address_new("127.0.0.1", "9991");
+	osc::MessageSource source(address);
+
+	const unsigned int sizes[] = {1, 10, 100, 1000};
+	for(unsigned int s = 0; s < sizeof(sizes)/sizeof(unsigned int); ++s) {
+		unsigned int size = sizes[s];
+		osc::OscObject root;
+		vector<BenchObject *> objects;
+		for(unsigned int i = 0; i < size; ++i) {
+			stringstream addr;
+			addr << "/object/" << i;
+			objects.push_back(new BenchObject(addr.str()));
+			root.addOscObject(objects.back());
+		}
+		stringstream target, name;
+		target << "/object/" << (size - 1);
+		name << "dispatch/tree_" << size;
+		string targetAddress = target.str();
+		bench(name.str(), iterations / size + 1, [&](unsigned int i) {
+			osc::ReceivedMessage message(targetAddress, m);
+			consume(root.processOsc(message, source));
+		});
+		root.removeAllOscObjects();
+		for(unsigned int i = 0; i < objects.size(); ++i) {
+			delete objects[i];
+		}
+	}
+
+	lo_address_free(address);
+	lo_message_free(m);
+}
+
+// LOOPBACK
+
+/// receiver which counts received messages
+class BenchReceiver : public osc::OscReceiver {
+	public:
+		BenchReceiver() : count(0) {}
+		unsigned int count;
+	protected:
+		bool process(const osc::ReceivedMessage &message, const osc::MessageSource &source) {
+			count++;
+			return true;
+		}
+};
+
+/// send messages to a receiver on localhost & wait for each to arrive
+void benchLoopback() {
+	BenchReceiver receiver;
+	if(!receiver.setup(port)) {
+		cerr << "loopback: could not open port " << port << ", skipping" << endl;
+		return;
+	}
+	osc::OscSender sender("127.0.0.1", port);
+	bench("loopback/round_trip", iterations / 10, [&](unsigned int i) {
+		unsigned int expected = receiver.count + 1;
+		sender << osc::BeginMessage("/bench") << (int32_t) i << (float) i << osc::EndMessage();
+		sender.send();
+		while(receiver.count < expected) {
+			if(receiver.handleMessages(100) <= 0) {
+				break; // lost
+			}
+		}
+	});
+	bench("loopback/send_only", iterations / 10, [&](unsigned int i) {
+		sender << osc::BeginMessage("/bench") << (int32_t) i << (float) i << osc::EndMessage();
+		sender.send();
+		receiver.handleMessages(0);
+	});
+	while(receiver.handleMessages(10) > 0) {} // drain
+}
+
+// MAIN
+
+void usage() {
+	cout << "Usage: lpbench [-n ITERATIONS] [-p PORT] [-f FILTER] [--json]" << endl
+	     << endl
+	     << "  -n ITERATIONS  base iterations per benchmark, default 100000" << endl
+	     << "  -p PORT        loopback port, default 9991" << endl
+	     << "  -f FILTER      only run benchmarks whose name contains FILTER" << endl
+	     << "  --json         print JSON lines instead of CSV" << endl
+	     << endl
+	     << "CSV output columns: benchmark,iterations,ns_per_op,ops_per_sec" << endl;
+}
+
+int main(int argc, char *argv[]) {
+
+	for(int i = 1; i < argc; ++i) {
+		if(!strcmp(argv[i], "-n") && i+1 < argc) {
+			iterations = strtoul(argv[++i], NULL, 10);
+		}
+		else if(!strcmp(argv[i], "-p") && i+1 < argc) {
+			port = strtoul(argv[++i], NULL, 10);
+		}
+		else if(!strcmp(argv[i], "-f") && i+1 < argc) {
+			filter = argv[++i];
+		}
+		else if(!strcmp(argv[i], "--json")) {
+			json = true;
+		}
+		else {
+			usage();
+			return strcmp(argv[i], "-h") && strcmp(argv[i], "--help") ? 1 : 0;
+		}
+	}
+	if(iterations < 10) {
+		iterations = 10;
+	}
+
+	if(!json) {
+		cout << "benchmark,iterations,ns_per_op,ops_per_sec" << endl;
+	}
+	benchEncode();
+	benchBundles();
+	benchDecode();
+	benchDispatch();
+	benchLoopback();
+
+	return 0;
+}
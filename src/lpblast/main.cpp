@@ -0,0 +1,293 @@
+/*==============================================================================
+
+	main.cpp
+
+	lpblast: lopack OSC load generator
+
+	Copyright (C) 2026 Dan Wilcox <danomatika@gmail.com>
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================*/
+#include <lopack/lopack.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <string.h>
+#include <stdlib.h>
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+/// send rate pattern
+enum Mode {
+	MODE_CONSTANT, //< evenly spaced packets
+	MODE_BURSTY,   //< bursts of packets, evenly spaced bursts
+	MODE_POISSON   //< exponentially distributed packet spacing
+};
+
+// options
+static string host = "127.0.0.1";    //< destination host or multicast group
+static unsigned int port = 9990;     //< destination port
+static unsigned int threads = 1;     //< number of sending threads
+static unsigned int sockets = 1;     //< number of senders (sockets) per thread
+static double rate = 1000;           //< target packets/s for all threads, 0 = max
+static Mode mode = MODE_CONSTANT;    //< rate pattern
+static unsigned int burst = 100;     //< packets per burst in bursty mode
+static double duration = 10;         //< seconds to run
+static unsigned int addresses = 16;  //< number of distinct addresses
+static string prefix = "/blast";     //< address prefix
+static double zipf = 0;              //< address zipf exponent, 0 = uniform
+static string types = "if";          //< argument type mix per message
+static unsigned int bundle = 1;      //< messages per packet, > 1 sends bundles
+static double interval = 1;          //< seconds between progress reports
+
+// stats
+static atomic<uint64_t> packetsSent(0);  //< packets sent successfully
+static atomic<uint64_t> messagesSent(0); //< messages sent successfully
+static atomic<uint64_t> sendErrors(0);   //< failed sends
+static atomic<bool> running(true);       //< keep sending?
+
+/// address distribution, cumulative probabilities for each address
+static vector<double> addressCdf;
+static vector<string> addressNames;
+
+/// build the address names & zipf distribution, exponent 0 is uniform
+void setupAddresses() {
+	double total = 0;
+	for(unsigned int i = 0; i < addresses; ++i) {
+		stringstream name;
+		name << prefix << "/" << i;
+		addressNames.push_back(name.str());
+		total += 1.0 / pow(i + 1, zipf);
+		addressCdf.push_back(total);
+	}
+	for(unsigned int i = 0; i < addresses; ++i) {
+		addressCdf[i] /= total;
+	}
+}
+
+/// pick an address according to the distribution
+const string& pickAddress(mt19937 &random) {
+	double r = uniform_real_distribution<double>(0, 1)(random);
+	vector<double>::iterator iter = lower_bound(addressCdf.begin(), addressCdf.end(), r);
+	size_t index = min((size_t)(iter - addressCdf.begin()), addressNames.size() - 1);
+	return addressNames[index];
+}
+
+/// add a message using the argument type mix
+void addMessage(osc::OscSender &sender, const string &address, uint64_t count) {
+	static const char blobData[] = "0123456789abcdef";
+	osc::MidiMessage midi;
+	sender << osc::BeginMessage(address);
+	for(unsigned int i = 0; i < types.size(); ++i) {
+		switch(types[i]) {
+			case 'T': sender << true; break;
+			case 'F': sender << false; break;
+			case 'c': sender << (char) ('a' + count % 26); break;
+			case 'N': sender << osc::Nil(); break;
+			case 'I': sender << osc::Infinitum(); break;
+			case 'i': sender << (int32_t) count; break;
+			case 'h': sender << (int64_t) count; break;
+			case 'f': sender << (float) count; break;
+			case 'd': sender << (double) count; break;
+			case 's': sender << "blast"; break;
+			case 'S': sender << osc::Symbol("blast"); break;
+			case 'm': sender << midi; break;
+			case 't': sender << osc::TimeTag(); break;
+			case 'b': sender << osc::Blob(blobData, sizeof(blobData)); break;
+			default: break;
+		}
+	}
+	sender << osc::EndMessage();
+}
+
+/// sending thread, sends at rate packets/s round robin over its senders
+void blast(unsigned int index, double threadRate) {
+	mt19937 random(index + 1);
+	exponential_distribution<double> poisson(threadRate > 0 ? threadRate : 1);
+	vector<osc::OscSender *> senders;
+	for(unsigned int i = 0; i < sockets; ++i) {
+		senders.push_back(new osc::OscSender(host, port));
+	}
+
+	Clock::time_point next = Clock::now();
+	uint64_t count = 0;
+	unsigned int current = 0;
+	while(running.load(memory_order_relaxed)) {
+
+		// wait until the next packet is due, don't sleep if we are behind
+		if(threadRate > 0) {
+			double wait = 0;
+			switch(mode) {
+				case MODE_CONSTANT:
+					wait = 1.0 / threadRate;
+					break;
+				case MODE_BURSTY:
+					wait = (count % burst == 0) ? burst / threadRate : 0;
+					break;
+				case MODE_POISSON:
+					wait = poisson(random);
+					break;
+			}
+			next += chrono::duration_cast<Clock::duration>(chrono::duration<double>(wait));
+			if(next > Clock::now()) {
+				this_thread::sleep_until(next);
+			}
+		}
+
+		// build & send
+		osc::OscSender &sender = *senders[current];
+		current = (current + 1) % senders.size();
+		if(bundle > 1) {
+			sender << osc::BeginBundle();
+			for(unsigned int i = 0; i < bundle; ++i) {
+				addMessage(sender, pickAddress(random), count);
+			}
+			sender << osc::EndBundle();
+		}
+		else {
+			addMessage(sender, pickAddress(random), count);
+		}
+		if(sender.send()) {
+			packetsSent.fetch_add(1, memory_order_relaxed);
+			messagesSent.fetch_add(bundle, memory_order_relaxed);
+		}
+		else {
+			sendErrors.fetch_add(1, memory_order_relaxed);
+		}
+		count++;
+	}
+
+	for(unsigned int i = 0; i < senders.size(); ++i) {
+		delete senders[i];
+	}
+}
+
+void usage() {
+	cout << "Usage: lpblast [options]" << endl
+	     << endl
+	     << "  -H HOST       destination host or multicast group, default 127.0.0.1" << endl
+	     << "  -p PORT       destination port, default 9990" << endl
+	     << "  -t THREADS    number of sending threads, default 1" << endl
+	     << "  -s SOCKETS    number of sockets per thread, default 1" << endl
+	     << "  -r RATE       target packets/s for all threads, 0 = max, default 1000" << endl
+	     << "  -m MODE       rate pattern: constant, bursty, or poisson, default constant" << endl
+	     << "  -B BURST      packets per burst in bursty mode, default 100" << endl
+	     << "  -d SECONDS    run duration, default 10" << endl
+	     << "  -a COUNT      number of distinct addresses, default 16" << endl
+	     << "  -P PREFIX     address prefix, default /blast" << endl
+	     << "  -z EXPONENT   zipf address distribution exponent, 0 = uniform, default 0" << endl
+	     << "  -A TYPES      argument types per message, any of TFcNIihfdsSmtb, default if" << endl
+	     << "  -b COUNT      messages per packet, > 1 sends bundles, default 1" << endl
+	     << "  -i SECONDS    progress report interval, default 1" << endl;
+}
+
+int main(int argc, char *argv[]) {
+
+	for(int i = 1; i < argc; ++i) {
+		string arg = argv[i];
+		if(arg == "-h" || arg == "--help") {
+			usage();
+			return 0;
+		}
+		if(i+1 >= argc) {
+			usage();
+			return 1;
+		}
+		string value = argv[++i];
+		if(arg == "-H") {host = value;}
+		else if(arg == "-p") {port = strtoul(value.c_str(), NULL, 10);}
+		else if(arg == "-t") {threads = max(1UL, strtoul(value.c_str(), NULL, 10));}
+		else if(arg == "-s") {sockets = max(1UL, strtoul(value.c_str(), NULL, 10));}
+		else if(arg == "-r") {rate = max(0.0, strtod(value.c_str(), NULL));}
+		else if(arg == "-m") {
+			if(value == "constant") {mode = MODE_CONSTANT;}
+			else if(value == "bursty") {mode = MODE_BURSTY;}
+			else if(value == "poisson") {mode = MODE_POISSON;}
+			else {
+				cerr << "unknown mode: " << value << endl;
+				return 1;
+			}
+		}
+		else if(arg == "-B") {burst = max(1UL, strtoul(value.c_str(), NULL, 10));}
+		else if(arg == "-d") {duration = strtod(value.c_str(), NULL);}
+		else if(arg == "-a") {addresses = max(1UL, strtoul(value.c_str(), NULL, 10));}
+		else if(arg == "-P") {prefix = value;}
+		else if(arg == "-z") {zipf = max(0.0, strtod(value.c_str(), NULL));}
+		else if(arg == "-A") {types = value;}
+		else if(arg == "-b") {bundle = max(1UL, strtoul(value.c_str(), NULL, 10));}
+		else if(arg == "-i") {interval = max(0.1, strtod(value.c_str(), NULL));}
+		else {
+			usage();
+			return 1;
+		}
+	}
+	setupAddresses();
+
+	cout << "blasting " << host << ":" << port << " with " << threads << " thread(s) x "
+	     << sockets << " socket(s) for " << duration << "s" << endl;
+
+	// start threads
+	Clock::time_point start = Clock::now();
+	vector<thread> workers;
+	for(unsigned int i = 0; i < threads; ++i) {
+		workers.push_back(thread(blast, i, rate / threads));
+	}
+
+	// report progress
+	uint64_t lastPackets = 0, lastMessages = 0;
+	Clock::time_point last = start;
+	while(true) {
+		this_thread::sleep_for(chrono::duration<double>(interval));
+		Clock::time_point now = Clock::now();
+		double elapsed = chrono::duration<double>(now - last).count();
+		uint64_t packets = packetsSent.load(), messages = messagesSent.load();
+		cout << "  " << (packets - lastPackets) / elapsed << " packets/s "
+		     << (messages - lastMessages) / elapsed << " msgs/s "
+		     << sendErrors.load() << " errors" << endl;
+		lastPackets = packets;
+		lastMessages = messages;
+		last = now;
+		if(chrono::duration<double>(now - start).count() >= duration) {
+			break;
+		}
+	}
+
+	// stop threads
+	running.store(false);
+	for(unsigned int i = 0; i < workers.size(); ++i) {
+		workers[i].join();
+	}
+
+	// final report
+	double elapsed = chrono::duration<double>(Clock::now() - start).count();
+	cout << "sent " << packetsSent.load() << " packets " << messagesSent.load()
+	     << " messages in " << elapsed << "s" << endl
+	     << "achieved " << packetsSent.load() / elapsed << " packets/s "
+	     << messagesSent.load() / elapsed << " msgs/s";
+	if(rate > 0) {
+		cout << " (target " << rate << " packets/s)";
+	}
+	cout << endl << "send errors " << sendErrors.load() << endl;
+
+	return sendErrors.load() > 0 ? 1 : 0;
+}
@@ -59,6 +59,8 @@ class TestReceiver : public osc::OscReceiver {
 			cout << "TestReceiver: received message " << message.address()
 			     << (message.types().length() > 0 ? " " + message.types() : "")
 			     << message.types() << " from " << source.getUrl() << endl;
+			cout << "  arrival to dispatch: " << message.arrivalToDispatchLatency() * 1000000 << " us"
+			     << (message.hasKernelArrivalTime() ? " (kernel timestamp)" : "") << endl;
 
 			// exit on /quit message
 			if(message.address() == "/quit") {
@@ -21,6 +21,9 @@
 
 ==============================================================================*/
 #include "TestReceiver.h"
+#include <atomic>
+#include <new>
+#include <stdlib.h>
 
 // sleep in seconds
 #ifdef WIN32
@@ -29,6 +32,27 @@
 	#define SLEEP(seconds) usleep(seconds * 1000000)
 #endif
 
+// count heap allocations made through operator new for the allocation test,
+// liblo allocates with malloc & isn't counted
+static atomic<unsigned long> allocations(0);
+
+void* operator new(size_t size) {
+	allocations++;
+	void *p = malloc(size);
+	if(!p) {
+		throw bad_alloc();
+	}
+	return p;
+}
+
+void operator delete(void *p) noexcept {
+	free(p);
+}
+
+void operator delete(void *p, size_t size) noexcept {
+	free(p);
+}
+
 // OscObject subclass which recieves messages automatically when added to
 // OscReceiver
 class Object : public osc::OscObject {
@@ -132,11 +156,264 @@ void testSender() {
 	sender << osc::BeginMessage("/object") << 123 << 456.78f << "foo bar" << osc::EndMessage();
 	sender.send();
 	
+	// send message to be handled by a typed handler
+	sender << osc::BeginMessage("/synth/note") << 60 << 0.8f << osc::EndMessage();
+	sender.send();
+	
 	// send quit message
 	sender << osc::BeginMessage("/quit") << osc::EndMessage();
 	sender.send();
 }
 
+// OscObject subclass which reads a meter frame without allocating
+class FrameObject : public osc::OscObject {
+
+	public:
+	
+		FrameObject() : osc::OscObject("/alloc/test/meter/frame"), frames(0) {}
+	
+		unsigned int frames; // number of frames handled
+	
+	protected:
+	
+		bool processOscMessage(const osc::ReceivedMessage &message, const osc::MessageSource &source) {
+			if(message.addressView() == oscRootAddress && message.numArgs() == 66 &&
+			   message.isInt32(0) && message.isString(65)) {
+				float values[64];
+				message.readFloats(1, 64, values);
+				frames++;
+				return true;
+			}
+			return false;
+		}
+};
+
+// send & receive frames through the loopback, lopack should not allocate
+// once the sender & receiver buffers have grown, returns true on success
+bool testAllocations() {
+	const unsigned int warmup = 10, cycles = 1000;
+
+	osc::OscReceiver receiver;
+	if(!receiver.setup(9991)) {
+		return false;
+	}
+	FrameObject object;
+	receiver.addOscObject(&object);
+	osc::OscSender sender("127.0.0.1", 9991);
+
+	float frame[64];
+	for(unsigned int i = 0; i < 64; ++i) {
+		frame[i] = i / 64.0f;
+	}
+	unsigned long start = 0;
+	for(unsigned int i = 0; i < warmup + cycles; ++i) {
+		if(i == warmup) {
+			start = allocations.load();
+		}
+		sender << osc::BeginMessage("/alloc/test/meter/frame") << (int32_t) i;
+		sender.addFloats(frame, 64);
+		sender << "end of frame" << osc::EndMessage();
+		sender.send();
+		receiver.handleMessages(100);
+	}
+	unsigned long count = allocations.load() - start;
+
+	cout << "handled " << object.frames << " frames, " << count
+	     << " allocations in " << cycles << " send/receive cycles" << endl;
+	return count == 0 && object.frames == warmup + cycles;
+}
+
+// OscObject subclass which removes & re-adds another object from its handler
+class TogglerObject : public osc::OscObject {
+
+	public:
+	
+		TogglerObject(osc::OscReceiver &receiver, osc::OscObject &other) :
+			osc::OscObject("/change/toggle"), receiver(receiver), other(other), toggles(0) {}
+	
+		osc::OscReceiver &receiver; // receiver holding both objects
+		osc::OscObject &other;      // object to toggle
+		atomic<unsigned int> toggles; // number of messages handled
+	
+	protected:
+	
+		bool processOscMessage(const osc::ReceivedMessage &message, const osc::MessageSource &source) {
+			if(message.addressView() == oscRootAddress) {
+				receiver.removeOscObject(&other);
+				receiver.addOscObject(&other);
+				toggles++;
+				return true;
+			}
+			return false;
+		}
+};
+
+// add & remove objects from the main thread while a handler on the receive
+// thread changes the same list, returns true if every message was handled
+bool testObjectChanges() {
+	const unsigned int messages = 200;
+
+	osc::OscReceiver receiver;
+	if(!receiver.setup(9992)) {
+		return false;
+	}
+	osc::OscObject other("/change/other"), extra("/change/extra");
+	TogglerObject toggler(receiver, other);
+	receiver.addOscObject(&other);
+	receiver.addOscObject(&toggler);
+	receiver.start();
+
+	osc::OscSender sender("127.0.0.1", 9992);
+	for(unsigned int i = 0; i < messages; ++i) {
+		sender << osc::BeginMessage("/change/toggle") << osc::EndMessage();
+		sender.send();
+		receiver.addOscObject(&extra);
+		receiver.removeOscObject(&extra);
+	}
+	for(unsigned int i = 0; i < 100 && toggler.toggles < messages; ++i) {
+		SLEEP(0.01);
+	}
+	receiver.stop();
+
+	cout << "handled " << toggler.toggles << " of " << messages
+	     << " messages while changing objects" << endl;
+	return toggler.toggles == messages;
+}
+
+// waiter callback, counts completed waits
+void awaitCB(osc::MessageWaiters::Waiter *waiter) {
+	((atomic<unsigned int> *) waiter->userData)->fetch_add(1);
+}
+
+#ifdef LOPACK_HAVE_COROUTINES
+// coroutine which waits for a message & stores its argument, -1 on timeout
+osc::Task awaitNext(osc::OscReceiver &receiver, atomic<int> &result) {
+	auto message = co_await receiver.next("/await/next", 1);
+	result = message ? message->asInt32(0) : -1;
+}
+#endif
+
+// wait for messages from the receive thread, one arrives & one times out,
+// returns true if both complete as expected
+bool testAwait() {
+#ifdef LOPACK_HAVE_COROUTINES
+	atomic<int> result(0); // outlives the receiver, which resumes pending waits
+#endif
+	osc::OscReceiver receiver;
+	if(!receiver.setup(9993)) {
+		return false;
+	}
+	receiver.start();
+	osc::OscSender sender("127.0.0.1", 9993);
+
+	atomic<unsigned int> completed(0);
+	osc::MessageWaiters::Waiter reply, never;
+	reply.complete = never.complete = &awaitCB;
+	reply.userData = never.userData = &completed;
+	reply.address = "/await/reply";
+	reply.timeout = 1;
+	never.address = "/await/never";
+	never.timeout = 0.05;
+	receiver.getWaiters().add(reply);
+	receiver.getWaiters().add(never);
+	sender << osc::BeginMessage("/await/reply") << 42 << osc::EndMessage();
+	sender.send();
+
+#ifdef LOPACK_HAVE_COROUTINES
+	awaitNext(receiver, result);
+	sender << osc::BeginMessage("/await/next") << 43 << osc::EndMessage();
+	sender.send();
+#endif
+
+	for(unsigned int i = 0; i < 100 && completed < 2; ++i) {
+		SLEEP(0.01);
+	}
+#ifdef LOPACK_HAVE_COROUTINES
+	for(unsigned int i = 0; i < 100 && result == 0; ++i) {
+		SLEEP(0.01);
+	}
+#endif
+	receiver.getWaiters().remove(reply); // in case they did not complete
+	receiver.getWaiters().remove(never);
+	receiver.stop();
+
+	bool success = completed == 2 && reply.message && !never.message &&
+	               reply.message->asInt32(0) == 42;
+	cout << "reply " << (reply.message ? "received" : "missing") << ", "
+	     << "timeout " << (!never.message ? "expired" : "missing") << endl;
+#ifdef LOPACK_HAVE_COROUTINES
+	cout << "coroutine received " << result << endl;
+	success = success && result == 43;
+#endif
+	return success;
+}
+
+// send a bundle time tagged 50 ms in the future, which liblo holds in its
+// event queue until due, returns true if it was dispatched
+bool testScheduled() {
+	osc::OscReceiver receiver;
+	if(!receiver.setup(9994)) {
+		return false;
+	}
+	atomic<int> received(0);
+	receiver.on<int32_t>("/scheduled", [&received](int32_t value) {
+		received = value;
+	});
+	receiver.start();
+
+	osc::OscSender sender("127.0.0.1", 9994);
+	sender << osc::BeginBundle(osc::TimeTag(50))
+	       << osc::BeginMessage("/scheduled") << 50 << osc::EndMessage()
+	       << osc::EndBundle();
+	sender.send();
+	for(unsigned int i = 0; i < 100 && received == 0; ++i) {
+		SLEEP(0.01);
+	}
+	receiver.stop();
+
+	cout << "scheduled bundle " << (received == 50 ? "received" : "missing") << endl;
+	return received == 50;
+}
+
+// drop a reliable packet by sending it to an unused port, the receiver
+// should hold the next packet, NACK the gap, & get the retransmit
+bool testReliable() {
+	osc::OscReceiver receiver;
+	if(!receiver.setup(9995) || !receiver.setReliable(true)) {
+		return false;
+	}
+	atomic<int> expected(0);
+	atomic<bool> inOrder(true);
+	receiver.on<int32_t>("/reliable", [&expected, &inOrder](int32_t value) {
+		if(value != expected) {
+			inOrder = false;
+		}
+		expected = value + 1;
+	});
+	receiver.start();
+
+	osc::OscSender sender("127.0.0.1", 9995);
+	if(!sender.setReliable(true)) {
+		receiver.stop();
+		return false;
+	}
+	for(int i = 0; i < 3; ++i) {
+		sender.setup("127.0.0.1", i == 1 ? 9996 : 9995); // lose packet 1
+		sender << osc::BeginMessage("/reliable") << i << osc::EndMessage();
+		sender.send();
+	}
+	for(unsigned int i = 0; i < 100 && expected < 3; ++i) {
+		SLEEP(0.01);
+	}
+	receiver.stop();
+
+	osc::ReliableStats sent = sender.getReliableStats();
+	osc::ReliableStats received = receiver.getReliableStreams()->getStats();
+	cout << "delivered " << received.delivered << " in " << (inOrder ? "order" : "the wrong order")
+	     << ", reordered " << received.reordered << ", retransmits " << sent.retransmits << endl;
+	return expected == 3 && inOrder && received.reordered >= 1 && sent.retransmits >= 1;
+}
+
 int main(int argc, char *argv[]) {
 
 	cout << endl;
@@ -150,6 +427,17 @@ int main(int argc, char *argv[]) {
 	
 	Object object;
 	receiver.addOscObject(&object);
+
+	// typed handler, called with the decoded arguments
+	receiver.on<int32_t, float>("/synth/note", [](int32_t note, float velocity) {
+		cout << "Handler: received note " << note << " " << velocity << endl;
+	});
+
+	// count messages & time handlers
+	receiver.enableMetrics(true);
+
+	// use kernel receive timestamps for arrival times, if available
+	receiver.setKernelTimestamps(true);
 	
 	SLEEP(2);
 	
@@ -166,10 +454,34 @@ int main(int argc, char *argv[]) {
 		SLEEP(1);
 		receiver.stop();
 		cout << "DONE" << endl << endl;
+
+		cout << "RECEIVER METRICS" << endl;
+		receiver.getMetrics()->snapshot().print();
+		cout << "DONE" << endl << endl;
 	}
-	catch(osc::ReceiveException e) {
+	catch(const osc::ReceiveException &e) {
 		cout << "CAUGHT EXCEPTION: "<< e.what() << endl;
 	}
+
+	cout << "AWAIT TEST" << endl;
+	bool await = testAwait();
+	cout << (await ? "DONE" : "FAILED") << endl << endl;
+
+	cout << "SCHEDULED BUNDLE TEST" << endl;
+	bool scheduled = testScheduled();
+	cout << (scheduled ? "DONE" : "FAILED") << endl << endl;
+
+	cout << "RELIABLE DELIVERY TEST" << endl;
+	bool reliable = testReliable();
+	cout << (reliable ? "DONE" : "FAILED") << endl << endl;
+
+	cout << "OBJECT CHANGE TEST" << endl;
+	bool objectChanges = testObjectChanges();
+	cout << (objectChanges ? "DONE" : "FAILED") << endl << endl;
+
+	cout << "ALLOCATION TEST" << endl;
+	bool allocationFree = testAllocations();
+	cout << (allocationFree ? "DONE" : "FAILED") << endl << endl;
 	
-	return 0;
+	return allocationFree && objectChanges && await && scheduled && reliable ? 0 : 1;
 }